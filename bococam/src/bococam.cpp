@@ -8,327 +8,3749 @@
 
 #define HALF_MULTIPLIER 0.5
 
+#define MAX_CAMERAS 8
+#define INVALID_CAMERA_HANDLE 0
+
+#define MAX_TIME_STEP 0.1f
+
+#define MAX_LAYERS 8
+
+#define PERSPECTIVE_FOV 0.7854f      // 45 degrees
+#define PERSPECTIVE_MAX_FOV 3.1416f  // Exclusive bound of the field of view, 180 degrees
+#define PERSPECTIVE_NEAR_Z 1.0f
+#define PERSPECTIVE_FAR_Z 10000.0f
+
+// Engine writes queued on a camera, applied together by FlushCamera
+#define PENDING_VIEW 1   // Position and scale of the world target
+#define PENDING_OBJECT 2 // Position and rotation of the camera game object
+#define PENDING_RESIZE 4 // Window size change, logged when applied
+
+#define SHAKE_MAX_OFFSET 32.0f
+#define SHAKE_MAX_ANGLE 0.1f
+#define SHAKE_FREQUENCY 15.0f
+#define SHAKE_DECAY 1.0f
+
+// Easing curves of the zoom tweens
+enum Easing
+{
+    EASING_LINEAR = 0,
+    EASING_IN_OUT_SINE = 1,
+    EASING_OUT_CUBIC = 2,
+    EASING_IN_OUT_CUBIC = 3,
+};
+
+// Policies mapping the display size (game.project) to the window
+enum ScaleMode
+{
+    SCALE_EXPAND = 0,  // Uniform scale fitting the display in the window, showing more of the world on the longer side
+    SCALE_FIT = 1,     // Uniform scale fitting the display in the window, with letterbox bars on the longer side
+    SCALE_FILL = 2,    // Uniform scale covering the window, cropping the display on the longer side
+    SCALE_STRETCH = 3, // Display stretched to the window, non-uniformly
+};
+
+// Transform math used by the local/world conversions
+enum TransformMode
+{
+    TRANSFORM_GENERAL = 0, // Any rotation and three-axis scale
+    TRANSFORM_2D = 1,      // Rotation around Z only, as in a 2D game
+};
+
+#define GRID_CELL_SIZE 256.0f
+#define GRID_END 0xffffffff
+#define GRID_MAX_CELL 1073741824.0f // Largest cell column or row, 2^30, so cell spans fit in 32 bits
+
 #include <dmsdk/sdk.h>
+#include <dmsdk/dlib/math.h>
+#include <dmsdk/dlib/intersection.h>
+#include <dmsdk/dlib/hashtable.h>
+#include <dmsdk/gui/gui.h>
+
+// SIMD instruction sets guaranteed by the target architecture, used by the batch kernels
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define BOCOCAM_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    // arm64 only: ARMv7 NEON flushes denormals to zero, which would alter the values passed through
+    #include <arm_neon.h>
+    #define BOCOCAM_NEON
+#endif
 
 using namespace dmVMath;
 
 // Structure to hold the current state of the camera system
 struct State
 {
-    bool isActive = false;   // Indicates if the camera system is active
-    bool isSuspend = false;  // Indicates if the camera system is suspended
-};
+    uint32_t current = INVALID_CAMERA_HANDLE; // Handle of the camera used by the conversion functions
+    uint32_t handles[MAX_CAMERAS] = {};       // Live handle stored at each camera index (0 when free)
+    uint16_t version = 0;                     // Bumped for every new camera so stale handles are rejected
+
+    bool isSuspend = false;  // Indicates if the camera system is suspended
+    uint64_t lastUpdateTime = 0; // Time of the previous extension update, in microseconds
+
+    uint32_t allocations = 0;     // Lua objects (vectors, matrices, hashes, tables) created by the module this frame
+    uint32_t lastAllocations = 0; // Lua objects created by the module during the previous frame
+
+    unsigned int displayWidth = DISPLAY_WIDTH;  // Display width
+    unsigned int displayHeight = DISPLAY_HEIGHT; // Display height
+};
+
+// Structure to hold a parallax layer, a world target moving slower or faster than the main one
+struct ParallaxLayer
+{
+    dmGameObject::HCollection collection; // Collection of the game object holding the layer
+    dmhash_t id;                      // Identifier of that game object, looked up so a deleted layer is skipped
+    float factor;                     // Part of the camera movement applied to the layer, 1 moves it with the world
+    float zoomFactor;                 // Part of the camera zoom applied to the layer, 1 zooms it with the world
+};
+
+// Structure to hold the camera properties and settings
+struct Camera
+{
+    dmGameObject::HInstance mainCam;   // Handle to the main camera object, resolved from its identifier once per frame
+    dmGameObject::HInstance worldTarget; // Handle to the world target, resolved from its identifier once per frame
+    dmGameObject::HCollection mainCamCollection; // Collection owning the main camera object
+    dmhash_t mainCamId;                // Identifier of the main camera object
+    dmGameObject::HCollection worldTargetCollection; // Collection owning the world target
+    dmhash_t worldTargetId;            // Identifier of the world target
+
+    float windowWidth = (float)DISPLAY_WIDTH;  // Window width for rendering
+    float windowHeight = (float)DISPLAY_HEIGHT; // Window height for rendering
+
+    float halfWidth = windowWidth * HALF_MULTIPLIER; // Half of the screen width, in screen units (window pixels unless stretched)
+    float halfHeight = windowHeight * HALF_MULTIPLIER; // Half of the screen height, in screen units
+
+    ScaleMode scaleMode = SCALE_EXPAND; // Policy mapping the display to the window
+    float viewportX = 0.0f;             // Area of the window rendered to, in window pixels
+    float viewportY = 0.0f;
+    float viewportWidth = windowWidth;
+    float viewportHeight = windowHeight;
+
+    float zoom = 1.0f;            // Zoom level of the camera
+    float aspect = 1.0f;          // Aspect ratio of the camera
+
+    bool pixelPerfect = false;    // Indicates if the display scale is an integer and the view snapped to whole pixels
+    bool fractionalUpscale = false; // Indicates if the pixel-perfect scale leaves the rest of the window to a render target upscale
+    float upscale = 1.0f;         // Upscale left to the render script in pixel-perfect mode
+    
+    float invZoom = 1.0f / (zoom * aspect);  // Inverse of the zoom level
+
+    Point3 position = Point3(0.0f);  // World position shown at the center of the screen
+    bool ownsTranslation = false;    // Indicates if the camera moves the world target, once positioned by the camera API
+
+    Matrix4 view = Matrix4::identity();    // World to screen transform
+    Matrix4 invView = Matrix4::identity(); // Screen to world transform
+    Matrix4 viewProj = Matrix4::identity(); // World to clip space transform
+    Matrix4 invViewProj = Matrix4::identity(); // Clip space to world transform, used to unproject screen rays
+    Vector3 viewOffset = Vector3(0.0f);    // Camera position used by the view, after snapping
+    dmIntersection::Frustum frustum;       // Visible area, built from the view projection
+
+    bool isPerspective = false;            // Indicates if the camera uses a perspective projection
+    float fov = PERSPECTIVE_FOV;           // Vertical field of view, in radians
+    float nearZ = PERSPECTIVE_NEAR_Z;      // Near plane distance, in screen units
+    float farZ = PERSPECTIVE_FAR_Z;        // Far plane distance, in screen units
+    float planeZ = 0.0f;                   // Z of the world plane hit by screen positions in perspective mode
+
+    bool hasBounds = false;                // Indicates if the visible area is kept inside the level bounds
+    float boundsLeft = 0.0f;               // Level bounds, in world target space
+    float boundsBottom = 0.0f;
+    float boundsRight = 0.0f;
+    float boundsTop = 0.0f;
+
+    float cullMargin = 0.0f;               // Extra border, in pixels, kept visible around the screen when culling render entries
+
+    TransformMode transformMode = TRANSFORM_GENERAL; // Transform math of the local/world conversions
+
+    ParallaxLayer layers[MAX_LAYERS];      // Parallax layers, moved together with the world target
+    uint32_t layerCount = 0;               // Number of parallax layers
+
+    bool isFollowing = false;                     // Indicates if the camera follows a game object
+    dmGameObject::HCollection followCollection = 0; // Collection of the followed game object
+    dmhash_t followId = 0;                        // Identifier of the followed game object
+    float followSmoothTime = 0.0f;                // Time for the spring to (approximately) reach the target, 0 to snap
+    float deadZoneX = 0.0f;                       // Half width, in pixels, of the area the target moves in without moving the camera
+    float deadZoneY = 0.0f;                       // Half height, in pixels, of that area
+    float lookAhead = 0.0f;                       // Time, in seconds, the camera anticipates the target movement by
+    Vector3 followVelocity = Vector3(0.0f);       // Velocity of the camera spring
+    Point3 lastFollowTarget = Point3(0.0f);       // Target position during the previous update
+
+    bool isZooming = false;                       // Indicates if a zoom tween is running
+    float zoomFrom = 1.0f;                        // Zoom at the start of the tween
+    float zoomTo = 1.0f;                          // Zoom at the end of the tween
+    float zoomElapsed = 0.0f;                     // Time elapsed since the start of the tween
+    float zoomDuration = 0.0f;                    // Duration of the tween
+    Easing zoomEasing = EASING_LINEAR;            // Easing curve of the tween
+    float zoomAnchorX = 0.0f;                     // Screen position kept fixed while zooming
+    float zoomAnchorY = 0.0f;
+    Point3 zoomAnchorWorld = Point3(0.0f);        // World position under the anchor when the tween started
+
+    float trauma = 0.0f;                          // Shake intensity in [0, 1]; the shake amount is trauma squared
+    float traumaDecay = SHAKE_DECAY;              // Trauma removed per second
+    float shakeMaxOffset = SHAKE_MAX_OFFSET;      // Offset, in pixels, at full trauma
+    float shakeMaxAngle = SHAKE_MAX_ANGLE;        // Rotation, in radians, at full trauma
+    float shakeFrequency = SHAKE_FREQUENCY;       // Noise samples per second
+    float shakeTime = 0.0f;                       // Accumulated shake time, the noise input
+    uint32_t shakeSeed = 0;                       // Seed of the shake noise
+    bool isDirty = true;                   // Indicates if the view matrices must be rebuilt
+    uint8_t pending = 0;                   // PENDING_* flags of the engine writes queued for the next flush
+};
+
+// Structure to hold a game object registered in the spatial grid
+struct TrackedObject
+{
+    dmGameObject::HCollection collection; // Collection owning the game object
+    dmhash_t id;                          // Identifier of the game object
+    dmhash_t key;                         // Key of the object in `Grid::objectIndices`
+    Point3 position;                      // World position, refreshed once per frame
+    float radius;                         // Radius of the object, used by the queries
+    uint32_t next;                        // Next object in the same cell, or GRID_END
+};
+
+// Structure to hold the uniform spatial hash of the tracked game objects
+struct Grid
+{
+    dmArray<TrackedObject> objects;          // Tracked objects, densely packed
+    dmHashTable64<uint32_t> objectIndices;   // Object key to index in `objects`
+    dmHashTable64<uint32_t> cells;           // Cell key to the first object of the cell
+
+    float cellSize = GRID_CELL_SIZE;         // Width and height of a cell
+    float invCellSize = 1.0f / GRID_CELL_SIZE; // Inverse of the cell size
+    float maxRadius = 0.0f;                  // Largest object radius, used to widen the queried cells
+    bool isDirty = false;                    // Indicates if the cell lists must be rebuilt before a query
+};
+
+// Structure to hold a game object pointed at by an off-screen indicator
+struct IndicatorTarget
+{
+    dmGameObject::HCollection collection; // Collection owning the game object
+    dmhash_t id;                          // Identifier of the game object
+    bool isActive;                        // Indicates if the slot is in use
+};
+
+// Structure to hold a gui node kept over a game object
+struct GuiBinding
+{
+    dmGui::HScene scene;                  // Gui scene owning the node
+    dmGui::HNode node;                    // Node to move
+    int nodeRef;                          // Registry reference to the Lua node, checked before every update
+    dmGameObject::HCollection collection; // Collection owning the game object
+    dmhash_t id;                          // Identifier of the game object
+    Vector3 offset;                       // Offset, in gui units, added to the position of the game object
+    uint32_t camera;                      // Handle of the camera projecting the game object, or 0 for the current camera
+};
+
+// Structure to hold a collection whose game objects are referenced by the camera system
+struct WatchedCollection
+{
+    dmGameObject::HCollection collection; // The collection
+    dmMessage::HSocket socket;            // Message socket of the collection, deleted together with it
+};
+
+// Structure to hold the transforms of a game object, read once per frame
+struct CachedTransform
+{
+    dmTransform::Transform world; // World transform
+    Point3 localPosition;         // Local position
+};
+
+// Structure to hold the frame-scoped transform cache of the local/world conversions
+struct TransformCache
+{
+    dmHashTable64<CachedTransform> entries; // Instance to its transforms, cleared at the start of every frame
+    bool isEnabled = false;                 // Indicates if the conversions use the cache (opt-in)
+    uint32_t hits = 0;                      // Lookups served from the cache since the last stats reset
+    uint32_t misses = 0;                    // Lookups that had to query the engine
+};
+
+// Static global variables to hold camera and state data
+static Camera g_Cameras[MAX_CAMERAS]; // Camera slots, indexed by the lower 16 bits of the handles
+static State g_State;
+static Grid g_Grid;
+static TransformCache g_TransformCache;
+static dmArray<IndicatorTarget> g_Indicators; // Indicator slots; a slot keeps its index, which is the row of its results
+static dmArray<GuiBinding> g_GuiBindings;
+static dmArray<WatchedCollection> g_Collections; // Collections referenced by cameras, layers, follow targets, the grid, indicators and gui bindings
+
+/**
+ * Scales and offsets the X and Y of packed points, several points per instruction.
+ * Components after Y are copied unchanged.
+ * @return The number of points processed, from the start. The caller converts the remaining points.
+ */
+typedef uint32_t (*AffineKernel)(const float* in, float* out, uint32_t count, uint32_t stride, float scaleX, float scaleY, float offsetX, float offsetY);
+
+static AffineKernel g_AffineKernel = 0; // Selected at startup, 0 when SIMD is unavailable or disabled
+
+/**
+ * Frees a camera slot and invalidates its handle.
+ * @param handle The handle of a live camera.
+ *
+ * If it was the current camera, the camera system becomes inactive until another camera is initialized or selected.
+ */
+static void FreeCamera(uint32_t handle)
+{
+    uint32_t index = handle & 0xffff;
+    g_State.handles[index] = INVALID_CAMERA_HANDLE;
+
+    if (g_State.current == handle)
+    {
+        g_State.current = INVALID_CAMERA_HANDLE;
+    }
+}
+
+/**
+ * Looks up a camera from its handle.
+ * @param handle The camera handle returned by `init_camera`.
+ * @return The camera, or 0 if the handle is invalid or the camera has been released.
+ *
+ * The lower 16 bits of a handle hold the camera index and the upper 16 bits a version number,
+ * so the lookup is a bounds check, a handle compare and a dense array access.
+ *
+ * The camera and world target game objects are resolved once per frame by `ResolveCameras`, which releases
+ * the cameras whose objects were deleted, so the lookup touches no game object.
+ */
+static Camera* GetCamera(uint32_t handle)
+{
+    uint32_t index = handle & 0xffff;
+    if (handle == INVALID_CAMERA_HANDLE || index >= MAX_CAMERAS || g_State.handles[index] != handle)
+    {
+        return 0;
+    }
+    return &g_Cameras[index];
+}
+
+/**
+ * Gets the camera currently used by the conversion functions.
+ * @return The current camera, or 0 if no camera is active.
+ */
+static Camera* GetCurrentCamera()
+{
+    return GetCamera(g_State.current);
+}
+
+/**
+ * Gets the camera whose handle is at the given index of the Lua stack, or the current camera if the value is nil.
+ * @param L The Lua state.
+ * @param index The stack index of the handle.
+ * @return The camera. Raises a Lua error if a handle was given but is invalid.
+ */
+static Camera* CheckCamera(lua_State* L, int index)
+{
+    if (lua_isnoneornil(L, index))
+    {
+        return GetCurrentCamera();
+    }
+
+    Camera* camera = GetCamera((uint32_t)luaL_checknumber(L, index));
+    if (!camera)
+    {
+        luaL_error(L, "Invalid camera handle");
+    }
+    return camera;
+}
+
+/**
+ * Pushes a new vector3 onto the Lua stack, counting the allocation.
+ * @param L The Lua state.
+ * @param value The value of the vector.
+ */
+static void PushNewVector3(lua_State* L, const Vector3& value)
+{
+    ++g_State.allocations;
+    dmScript::PushVector3(L, value);
+}
+
+/**
+ * Pushes a new matrix4 onto the Lua stack, counting the allocation.
+ * @param L The Lua state.
+ * @param value The value of the matrix.
+ */
+static void PushNewMatrix4(lua_State* L, const Matrix4& value)
+{
+    ++g_State.allocations;
+    dmScript::PushMatrix4(L, value);
+}
+
+/**
+ * Pushes a new hash onto the Lua stack, counting the allocation.
+ * @param L The Lua state.
+ * @param value The hash.
+ */
+static void PushNewHash(lua_State* L, dmhash_t value)
+{
+    ++g_State.allocations;
+    dmScript::PushHash(L, value);
+}
+
+/**
+ * Pushes a vector3 result onto the Lua stack, reusing a caller-supplied vector when there is one.
+ * @param L The Lua state.
+ * @param outIndex The stack index of the optional output vector.
+ * @param value The result.
+ *
+ * The output vector is updated in place and pushed again, so the call creates no garbage.
+ */
+static void PushVector3Result(lua_State* L, int outIndex, const Vector3& value)
+{
+    if (lua_isnoneornil(L, outIndex))
+    {
+        PushNewVector3(L, value);
+        return;
+    }
+
+    *dmScript::CheckVector3(L, outIndex) = value;
+    lua_pushvalue(L, outIndex);
+}
+
+/**
+ * Allocates a free camera slot.
+ * @return The handle of the new camera, or INVALID_CAMERA_HANDLE if all the slots are in use.
+ */
+static uint32_t AllocCamera()
+{
+    uint32_t index = 0;
+    while (index < MAX_CAMERAS && g_State.handles[index] != INVALID_CAMERA_HANDLE)
+    {
+        ++index;
+    }
+    if (index == MAX_CAMERAS)
+    {
+        return INVALID_CAMERA_HANDLE;
+    }
+
+    if (++g_State.version == 0)
+    {
+        g_State.version = 1;
+    }
+    uint32_t handle = ((uint32_t)g_State.version << 16) | index;
+    g_State.handles[index] = handle;
+    return handle;
+}
+
+/**
+ * Registers a collection holding game objects referenced by the camera system, so its references are dropped
+ * when it is unloaded (see `PurgeCollections`).
+ * @param collection The collection.
+ */
+static void WatchCollection(dmGameObject::HCollection collection)
+{
+    for (uint32_t i = 0; i < g_Collections.Size(); ++i)
+    {
+        if (g_Collections[i].collection == collection)
+        {
+            return;
+        }
+    }
+
+    if (g_Collections.Full())
+    {
+        g_Collections.OffsetCapacity(dmMath::Max(8u, g_Collections.Capacity()));
+    }
+
+    WatchedCollection watched;
+    watched.collection = collection;
+    watched.socket = dmGameObject::GetMessageSocket(collection);
+    g_Collections.Push(watched);
+}
+
+/**
+ * Gets the size, in world units, of one screen unit on the plane the screen positions map to.
+ * @param camera The camera.
+ * @param zoom The zoom level, which may differ from the current one during a zoom change.
+ * @return The world size of a screen unit.
+ *
+ * This is `1 / (zoom * aspect)` for the orthographic projection. In perspective mode, the plane at `planeZ`
+ * lies `d - s * planeZ` away from the eye, with `d` the eye distance and `s = zoom * aspect`, so the value matches
+ * the scale of `invView` even before it is rebuilt.
+ */
+static float GetPlaneScale(const Camera& camera, float zoom)
+{
+    float scaleValue = zoom * camera.aspect;
+    if (!camera.isPerspective)
+    {
+        return 1.0f / scaleValue;
+    }
+
+    float distance = camera.halfHeight / tanf(camera.fov * 0.5f);
+    return (distance - scaleValue * camera.planeZ) / (scaleValue * distance);
+}
+
+/**
+ * Moves the camera position so the visible area stays inside the level bounds.
+ * @param camera The camera to clamp.
+ *
+ * On an axis where the level is smaller than the visible area, the level is centered instead.
+ */
+static void ClampToBounds(Camera& camera)
+{
+    // Visible area on the world plane
+    float planeScale = GetPlaneScale(camera, camera.zoom);
+    float halfWidth = camera.halfWidth * planeScale;
+    float halfHeight = camera.halfHeight * planeScale;
+
+    float minX = camera.boundsLeft + halfWidth;
+    float maxX = camera.boundsRight - halfWidth;
+    float minY = camera.boundsBottom + halfHeight;
+    float maxY = camera.boundsTop - halfHeight;
+
+    camera.position.setX(minX <= maxX ? dmMath::Clamp((float)camera.position.getX(), minX, maxX) : (camera.boundsLeft + camera.boundsRight) * HALF_MULTIPLIER);
+    camera.position.setY(minY <= maxY ? dmMath::Clamp((float)camera.position.getY(), minY, maxY) : (camera.boundsBottom + camera.boundsTop) * HALF_MULTIPLIER);
+}
+
+/**
+ * Rounds a world coordinate to the nearest coordinate landing on a whole screen pixel.
+ * @param value The world coordinate.
+ * @param scale The number of pixels per world unit.
+ * @return The snapped coordinate.
+ */
+static inline float SnapToPixel(float value, float scale)
+{
+    return floorf(value * scale + 0.5f) / scale;
+}
+
+/**
+ * Builds the perspective projection of a camera, in the space of the camera game object.
+ * @param camera The camera.
+ * @param nearZ The near plane distance.
+ * @param farZ The far plane distance.
+ * @return The projection.
+ *
+ * The eye sits above the center of the screen, at the distance where the field of view spans the screen height,
+ * so objects at Z 0 in the camera object space appear exactly as with the orthographic projection.
+ */
+static Matrix4 GetPerspectiveProjection(const Camera& camera, float nearZ, float farZ)
+{
+    float distance = camera.halfHeight / tanf(camera.fov * 0.5f);
+    return Matrix4::perspective(camera.fov, camera.halfWidth / camera.halfHeight, nearZ, farZ)
+        * Matrix4::translation(Vector3(-camera.halfWidth, -camera.halfHeight, -distance));
+}
+
+/**
+ * Casts the ray under a screen position and intersects it with the world plane of a camera.
+ * @param camera The camera, with an up to date inverse view projection.
+ * @param x The X screen position, relative to the center of the screen.
+ * @param y The Y screen position, relative to the center of the screen.
+ * @return The world position on the plane at `planeZ`.
+ */
+static Point3 UnprojectToPlane(const Camera& camera, float x, float y)
+{
+    float ndcX = x / camera.halfWidth;
+    float ndcY = y / camera.halfHeight;
+    const Vector4 nearPoint = camera.invViewProj * Vector4(ndcX, ndcY, -1.0f, 1.0f);
+    const Vector4 farPoint = camera.invViewProj * Vector4(ndcX, ndcY, 1.0f, 1.0f);
+    const Vector3 origin = nearPoint.getXYZ() / nearPoint.getW();
+    const Vector3 direction = farPoint.getXYZ() / farPoint.getW() - origin;
+
+    float t = direction.getZ() != 0.0f ? (camera.planeZ - origin.getZ()) / direction.getZ() : 0.0f;
+    return Point3(origin + direction * t);
+}
+
+/**
+ * Rebuilds the perspective view projection of a camera and the view mapping the screen to its world plane.
+ * @param camera The camera to update.
+ * @param scaleValue The scale of the world target, `zoom * aspect`.
+ *
+ * The world target is still scaled and moved like in orthographic mode, so the view projection chains that
+ * transform with the projection of `GetPerspectiveProjection`. As the camera looks straight down the Z axis,
+ * the plane maps to the screen with a scale and a translation, which are read back from three unprojected
+ * rays. `view` and `invView` stay affine, and every 2D conversion keeps working on the plane.
+ */
+static void UpdatePerspectiveView(Camera& camera, float scaleValue)
+{
+    const Matrix4 targetTransform = Matrix4::translation(Vector3(camera.halfWidth, camera.halfHeight, 0.0f))
+        * Matrix4::scale(Vector3(scaleValue)) * Matrix4::translation(-camera.viewOffset);
+    camera.viewProj = GetPerspectiveProjection(camera, camera.nearZ, camera.farZ) * targetTransform;
+    camera.invViewProj = Inverse(camera.viewProj);
+
+    // Rays through the screen edges keep the float error of the unprojection small relative to the scale
+    const Point3 center = UnprojectToPlane(camera, 0.0f, 0.0f);
+    float scaleX = (UnprojectToPlane(camera, camera.halfWidth, 0.0f).getX() - center.getX()) / camera.halfWidth;
+    float scaleY = (UnprojectToPlane(camera, 0.0f, camera.halfHeight).getY() - center.getY()) / camera.halfHeight;
+    const Vector3 translation(center.getX(), center.getY(), 0.0f);
+    camera.invView = Matrix4::translation(translation) * Matrix4::scale(Vector3(scaleX, scaleY, 1.0f));
+    camera.view = Matrix4::scale(Vector3(1.0f / scaleX, 1.0f / scaleY, 1.0f)) * Matrix4::translation(-translation);
+}
+
+/**
+ * Rebuilds the cached view matrices and frustum of a camera if its zoom, size or position changed.
+ * The position is clamped to the level bounds first, if any, and snapped to whole pixels in pixel-perfect mode.
+ * 
+ * @param camera The camera to update.
+ * 
+ * Screen positions are relative to the center of the screen, so the view is a scale by `zoom * aspect`
+ * around the camera position. The Z axis is left untouched. In perspective mode the view maps the screen
+ * to the world plane at `planeZ` instead, see `UpdatePerspectiveView`.
+ */
+static void UpdateView(Camera& camera)
+{
+    if (!camera.isDirty)
+    {
+        return;
+    }
+
+    float scaleValue = camera.zoom * camera.aspect;
+
+    // Update the inverse zoom factor
+    camera.invZoom = 1.0f / scaleValue;
+
+    if (camera.hasBounds)
+    {
+        ClampToBounds(camera);
+    }
+
+    Vector3 offset(camera.position.getX(), camera.position.getY(), 0.0f);
+    if (camera.pixelPerfect)
+    {
+        // Only the view is snapped, so slow movements still accumulate in the camera position
+        offset.setX(SnapToPixel(offset.getX(), scaleValue));
+        offset.setY(SnapToPixel(offset.getY(), scaleValue));
+    }
+    camera.viewOffset = offset;
+
+    if (camera.isPerspective)
+    {
+        UpdatePerspectiveView(camera, scaleValue);
+    }
+    else
+    {
+        camera.view = Matrix4::scale(Vector3(scaleValue, scaleValue, 1.0f)) * Matrix4::translation(-offset);
+        camera.invView = Matrix4::translation(offset) * Matrix4::scale(Vector3(camera.invZoom, camera.invZoom, 1.0f));
+
+        // The screen spans [-halfWidth, halfWidth] x [-halfHeight, halfHeight]
+        camera.viewProj = Matrix4::orthographic(-camera.halfWidth, camera.halfWidth, -camera.halfHeight, camera.halfHeight, -1.0f, 1.0f) * camera.view;
+        camera.invViewProj = Inverse(camera.viewProj);
+    }
+
+    // Only the 4 side planes are used, so culling ignores the depth range
+    dmIntersection::CreateFrustumFromMatrix(camera.viewProj, true, 4, camera.frustum);
+
+    camera.isDirty = false;
+}
+
+/**
+ * Gets the rectangle seen by a camera in engine world space (the space of `go.get_world_position`).
+ * 
+ * @param camera The camera.
+ * @param margin The border to add on every side.
+ * @param left Receives the left edge.
+ * @param bottom Receives the bottom edge.
+ * @param right Receives the right edge.
+ * @param top Receives the top edge.
+ * 
+ * The view starts at the camera object and spans the screen.
+ */
+static void GetEngineViewRect(const Camera& camera, float margin, float* left, float* bottom, float* right, float* top)
+{
+    const Point3 origin = dmGameObject::GetWorldPosition(camera.mainCam);
+    *left = origin.getX() - margin;
+    *bottom = origin.getY() - margin;
+    *right = origin.getX() + camera.halfWidth * 2.0f + margin;
+    *top = origin.getY() + camera.halfHeight * 2.0f + margin;
+}
+
+/**
+ * Gets the center of the screen of a camera in engine world space.
+ * @param camera The camera.
+ * @return The center of the screen.
+ *
+ * Screen positions of game objects are relative to this point, which keeps them in line with the camera
+ * object whatever the hierarchy of the game objects.
+ */
+static Point3 GetEngineScreenCenter(const Camera& camera)
+{
+    const Point3 origin = dmGameObject::GetWorldPosition(camera.mainCam);
+    return Point3(origin.getX() + camera.halfWidth, origin.getY() + camera.halfHeight, origin.getZ());
+}
+
+/**
+ * Rebuilds the view of a camera and applies it to its world target.
+ * 
+ * @param camera The camera to apply.
+ * 
+ * The world target is scaled by `zoom * aspect` and, once the camera owns its translation (see `init_camera`),
+ * moved so the camera position ends up at the center of the screen.
+ * Every parallax layer shows the camera position multiplied by its factor at the center of the screen, and blends
+ * between no zoom and the camera zoom by its zoom factor.
+ */
+static void ApplyView(Camera& camera)
+{
+    UpdateView(camera);
+
+    float scaleValue = camera.zoom * camera.aspect;
+
+    // Apply the calculated scale and offset to the world target; the offset is the (possibly snapped) view offset
+    if (camera.ownsTranslation)
+    {
+        const Vector3 translation = -camera.viewOffset * scaleValue;
+        Point3 targetPosition = dmGameObject::GetPosition(camera.worldTarget);
+        targetPosition.setX(camera.pixelPerfect ? floorf(translation.getX() + 0.5f) : translation.getX());
+        targetPosition.setY(camera.pixelPerfect ? floorf(translation.getY() + 0.5f) : translation.getY());
+        dmGameObject::SetPosition(camera.worldTarget, targetPosition);
+    }
+    dmGameObject::SetScale(camera.worldTarget, Vector3(scaleValue));
+
+    for (uint32_t i = 0; i < camera.layerCount; ++i)
+    {
+        const ParallaxLayer& layer = camera.layers[i];
+        dmGameObject::HInstance instance = dmGameObject::GetInstanceFromIdentifier(layer.collection, layer.id);
+        if (!instance)
+        {
+            continue;
+        }
+
+        float layerScale = (1.0f + (camera.zoom - 1.0f) * layer.zoomFactor) * camera.aspect;
+        float offset = -layer.factor * layerScale;
+
+        Point3 layerPosition = dmGameObject::GetPosition(instance);
+        layerPosition.setX(camera.position.getX() * offset);
+        layerPosition.setY(camera.position.getY() * offset);
+        if (camera.pixelPerfect)
+        {
+            layerPosition.setX(floorf(layerPosition.getX() + 0.5f));
+            layerPosition.setY(floorf(layerPosition.getY() + 0.5f));
+        }
+        dmGameObject::SetPosition(instance, layerPosition);
+        dmGameObject::SetScale(instance, Vector3(layerScale));
+    }
+}
+
+/**
+ * Marks the view of a camera as changed.
+ * @param camera The camera.
+ *
+ * The matrices are rebuilt lazily by the next conversion, while the world target is moved by the next `FlushCamera`,
+ * at the end of the script call or of the native update that changed the view.
+ */
+static inline void InvalidateView(Camera& camera)
+{
+    camera.isDirty = true;
+    camera.pending |= PENDING_VIEW;
+}
+
+/**
+ * Hashes a lattice point of the shake noise to a value in [-1, 1].
+ * @param index The lattice point.
+ * @param seed The noise seed.
+ * @return The noise value.
+ */
+static inline float NoiseValue(int32_t index, uint32_t seed)
+{
+    uint32_t h = (uint32_t)index * 0x9E3779B1u ^ seed;
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return (float)h * (2.0f / 4294967295.0f) - 1.0f;
+}
+
+/**
+ * Samples three independent channels of smooth 1D value noise.
+ * @param time The noise input.
+ * @param seed The noise seed.
+ * @return The X, Y and rotation channels, each in [-1, 1].
+ *
+ * The channels share the lattice position and the smoothstep weight, so they are interpolated together as one vector.
+ */
+static Vector3 SampleShakeNoise(float time, uint32_t seed)
+{
+    float lattice = floorf(time);
+    int32_t index = (int32_t)lattice;
+    float t = time - lattice;
+    t = t * t * (3.0f - 2.0f * t);
+
+    const Vector3 a(NoiseValue(index, seed), NoiseValue(index, seed + 1), NoiseValue(index, seed + 2));
+    const Vector3 b(NoiseValue(index + 1, seed), NoiseValue(index + 1, seed + 1), NoiseValue(index + 1, seed + 2));
+    return lerp(t, a, b);
+}
+
+/**
+ * Places the camera game object so the view is centered, adding the current shake offset and rotation.
+ * @param camera The camera to place.
+ *
+ * The rotation pivots around the center of the screen rather than the corner of the camera object.
+ */
+static void ApplyCameraObject(Camera& camera)
+{
+    Vector3 offset(0.0f);
+    Quat rotation = Quat::identity();
+
+    if (camera.trauma > 0.0f)
+    {
+        float shake = camera.trauma * camera.trauma;
+        const Vector3 noise = SampleShakeNoise(camera.shakeTime * camera.shakeFrequency, camera.shakeSeed);
+        offset = Vector3(noise.getX(), noise.getY(), 0.0f) * (shake * camera.shakeMaxOffset);
+        rotation = Quat::rotationZ(noise.getZ() * shake * camera.shakeMaxAngle);
+    }
+
+    const Vector3 center(camera.halfWidth, camera.halfHeight, 0.0f);
+    Point3 position(offset - dmVMath::Rotate(rotation, center));
+    if (camera.pixelPerfect)
+    {
+        position.setX(floorf(position.getX() + 0.5f));
+        position.setY(floorf(position.getY() + 0.5f));
+    }
+    dmGameObject::SetPosition(camera.mainCam, position);
+    dmGameObject::SetRotation(camera.mainCam, rotation);
+}
+
+/**
+ * Advances the shake of a camera and queues it for the camera game object.
+ * @param camera The camera to update.
+ * @param dt The time step in seconds.
+ */
+static void UpdateShake(Camera& camera, float dt)
+{
+    camera.shakeTime += dt;
+    camera.trauma = dmMath::Max(0.0f, camera.trauma - camera.traumaDecay * dt);
+    camera.pending |= PENDING_OBJECT;
+
+    // Every shake starts from the beginning of the noise, so a seed always replays the same shake
+    if (camera.trauma == 0.0f)
+    {
+        camera.shakeTime = 0.0f;
+    }
+}
+
+/**
+ * Resizes the camera's viewport and adjusts the world target's scale based on the window size.
+ * 
+ * @param camera The camera to resize.
+ * @param width The new width of the window.
+ * @param height The new height of the window.
+ * 
+ * This function recalculates the scaling factor for the camera according to its scale mode, the screen area
+ * and the viewport, and queues the necessary transformations of the camera and world target objects.
+ *
+ * The screen is the area seen through the camera object, in screen units. They are window pixels, except in
+ * stretch mode where the screen keeps the display size and the projection stretches it over the window.
+ */
+static void Resize(Camera& camera, const int& width, const int& height)
+{
+    // Calculate the scaling factors for both axes (X and Y)
+    float displayScaleX = (float)width / g_State.displayWidth;
+    float displayScaleY = (float)height / g_State.displayHeight;
+    
+    camera.windowWidth = width;
+    camera.windowHeight = height;
+
+    // Uniform modes fit the display on its limiting axis, or cover the window with it
+    camera.aspect = camera.scaleMode == SCALE_FILL ? fmax(displayScaleX, displayScaleY) : fmin(displayScaleX, displayScaleY);
+    camera.upscale = 1.0f;
+
+    if (camera.scaleMode == SCALE_STRETCH)
+    {
+        camera.aspect = 1.0f;
+    }
+    else if (camera.pixelPerfect)
+    {
+        // Integer scale, or 1/n below 1, so display pixels map to whole window pixels: the largest one that fits,
+        // or in fill mode the smallest one that still covers the window
+        float scale;
+        if (camera.scaleMode == SCALE_FILL)
+        {
+            scale = camera.aspect >= 1.0f ? ceilf(camera.aspect) : 1.0f / floorf(1.0f / camera.aspect);
+        }
+        else
+        {
+            scale = camera.aspect >= 1.0f ? floorf(camera.aspect) : 1.0f / ceilf(1.0f / camera.aspect);
+        }
+        if (camera.fractionalUpscale)
+        {
+            camera.upscale = camera.aspect / scale;
+        }
+        camera.aspect = scale;
+    }
+
+    if (camera.scaleMode == SCALE_FIT)
+    {
+        // Letterbox: only the scaled display is rendered, centered in the window
+        camera.viewportWidth = g_State.displayWidth * camera.aspect * camera.upscale;
+        camera.viewportHeight = g_State.displayHeight * camera.aspect * camera.upscale;
+        camera.halfWidth = g_State.displayWidth * camera.aspect * HALF_MULTIPLIER;
+        camera.halfHeight = g_State.displayHeight * camera.aspect * HALF_MULTIPLIER;
+    }
+    else
+    {
+        camera.viewportWidth = camera.windowWidth;
+        camera.viewportHeight = camera.windowHeight;
+        bool isStretched = camera.scaleMode == SCALE_STRETCH;
+        camera.halfWidth = (isStretched ? g_State.displayWidth : width / camera.upscale) * HALF_MULTIPLIER;
+        camera.halfHeight = (isStretched ? g_State.displayHeight : height / camera.upscale) * HALF_MULTIPLIER;
+    }
+    camera.viewportX = (camera.windowWidth - camera.viewportWidth) * HALF_MULTIPLIER;
+    camera.viewportY = (camera.windowHeight - camera.viewportHeight) * HALF_MULTIPLIER;
+
+    // The camera object is shifted to center the view, and the world target rescaled
+    InvalidateView(camera);
+    camera.pending |= PENDING_OBJECT | PENDING_RESIZE;
+}
+
+/**
+ * Applies the engine writes queued on a camera.
+ * @param camera The camera to flush.
+ *
+ * Called at the end of every script call changing the camera, and once per camera at the end of the extension
+ * update for the follow, zoom tween and shake, so each game object is moved at most once per step. Both run before
+ * the engine computes the world transforms, so the change shows in the same frame.
+ */
+static void FlushCamera(Camera& camera)
+{
+    if (camera.pending == 0)
+    {
+        return;
+    }
+
+    if (camera.pending & PENDING_OBJECT)
+    {
+        ApplyCameraObject(camera);
+    }
+
+    if (camera.pending & PENDING_VIEW)
+    {
+        ApplyView(camera);
+    }
+
+    if (camera.pending & PENDING_RESIZE)
+    {
+        dmLogInfo("Scale: %f", camera.zoom * camera.aspect);
+    }
+
+    camera.pending = 0;
+}
+
+/**
+ * Gets the camera position matching the current position of the world target.
+ * @param camera The camera, with its world target, zoom and aspect set.
+ * @return The world position at the center of the screen, inverting the translation written by `ApplyView`.
+ */
+static Point3 GetPositionFromTarget(const Camera& camera)
+{
+    float scaleValue = camera.zoom * camera.aspect;
+    const Point3 targetPosition = dmGameObject::GetPosition(camera.worldTarget);
+    return Point3(-targetPosition.getX() / scaleValue, -targetPosition.getY() / scaleValue, 0.0f);
+}
+
+/**
+ * Makes the camera own the translation of the world target (see `init_camera`).
+ * @param camera The camera.
+ *
+ * Until then scripts may have moved the world target themselves, so the camera position is first recomputed from
+ * the world target, and the view does not jump when the camera takes over.
+ */
+static void TakeTranslation(Camera& camera)
+{
+    if (camera.ownsTranslation)
+    {
+        return;
+    }
+
+    camera.position = GetPositionFromTarget(camera);
+    camera.ownsTranslation = true;
+    InvalidateView(camera);
+}
+
+/**
+ * Fetches a stream from a buffer, raising a Lua error if it is missing or unusable.
+ * @param L The Lua state used for error reporting.
+ * @param buffer The buffer holding the stream.
+ * @param streamName The hashed name of the stream.
+ * @param valueType The expected value type of the stream.
+ * @param minComponents The minimum number of components each element must have.
+ * @param data Receives the pointer to the first element.
+ * @param count Receives the number of elements in the stream.
+ * @param components Receives the number of components per element.
+ * @param stride Receives the distance between two elements, in values.
+ */
+static void CheckStream(lua_State* L, dmBuffer::HBuffer buffer, dmhash_t streamName, dmBuffer::ValueType valueType, uint32_t minComponents,
+                        void** data, uint32_t* count, uint32_t* components, uint32_t* stride)
+{
+    dmBuffer::ValueType type;
+    dmBuffer::Result result = dmBuffer::GetStreamType(buffer, streamName, &type, components);
+    if (result != dmBuffer::RESULT_OK)
+    {
+        luaL_error(L, "Unable to get stream '%s': %s", dmHashReverseSafe64(streamName), dmBuffer::GetResultString(result));
+        return;
+    }
+
+    if (type != valueType || *components < minComponents)
+    {
+        luaL_error(L, "Stream '%s' must be %s with at least %d components", dmHashReverseSafe64(streamName), dmBuffer::GetValueTypeString(valueType), minComponents);
+        return;
+    }
+
+    result = dmBuffer::GetStream(buffer, streamName, data, count, components, stride);
+    if (result != dmBuffer::RESULT_OK)
+    {
+        luaL_error(L, "Unable to get stream '%s': %s", dmHashReverseSafe64(streamName), dmBuffer::GetResultString(result));
+    }
+}
+
+/**
+ * Fetches a float32 stream from a buffer, raising a Lua error if it is missing or unusable.
+ * See `CheckStream`.
+ */
+static void CheckFloatStream(lua_State* L, dmBuffer::HBuffer buffer, dmhash_t streamName, uint32_t minComponents,
+                             float** data, uint32_t* count, uint32_t* components, uint32_t* stride)
+{
+    CheckStream(L, buffer, streamName, dmBuffer::VALUE_TYPE_FLOAT32, minComponents, (void**)data, count, components, stride);
+}
+
+#if defined(BOCOCAM_SSE2) || defined(BOCOCAM_NEON)
+/**
+ * SIMD implementation of `AffineKernel`, for strides of 2 to 4 floats.
+ *
+ * The points are not deinterleaved: the scale and offset of each lane follow the component it holds, a pattern
+ * repeating every lcm(stride, 4) floats. The lanes after Y are selected from the input with a bit mask rather
+ * than computed, so their bit patterns (NaNs included) are copied exactly. Only called for packed streams,
+ * where every float belongs to the converted points.
+ */
+static uint32_t AffineKernelSIMD(const float* in, float* out, uint32_t count, uint32_t stride, float scaleX, float scaleY, float offsetX, float offsetY)
+{
+    if (count == 0 || stride < 2 || stride > 4)
+    {
+        return 0;
+    }
+
+    uint32_t block = stride == 3 ? 12 : 4;
+    float DM_ALIGNED(16) scale[12];
+    float DM_ALIGNED(16) offset[12];
+    uint32_t DM_ALIGNED(16) mask[12];
+    for (uint32_t i = 0; i < block; ++i)
+    {
+        uint32_t component = i % stride;
+        scale[i] = component == 0 ? scaleX : (component == 1 ? scaleY : 1.0f);
+        offset[i] = component == 0 ? offsetX : (component == 1 ? offsetY : 0.0f);
+        mask[i] = component < 2 ? 0xffffffff : 0;
+    }
+
+    // Only whole blocks ending before the unused floats of the last point, which may lie past the buffer end
+    uint32_t blocks = ((count - 1) * stride + 2) / block;
+    uint32_t vectors = block / 4;
+
+#if defined(BOCOCAM_SSE2)
+    __m128 s[3], o[3], m[3];
+    for (uint32_t v = 0; v < vectors; ++v)
+    {
+        s[v] = _mm_load_ps(scale + v * 4);
+        o[v] = _mm_load_ps(offset + v * 4);
+        m[v] = _mm_castsi128_ps(_mm_load_si128((const __m128i*)(mask + v * 4)));
+    }
+
+    for (uint32_t b = 0; b < blocks; ++b)
+    {
+        for (uint32_t v = 0; v < vectors; ++v)
+        {
+            __m128 value = _mm_loadu_ps(in);
+            __m128 result = _mm_add_ps(_mm_mul_ps(value, s[v]), o[v]);
+            _mm_storeu_ps(out, _mm_or_ps(_mm_and_ps(m[v], result), _mm_andnot_ps(m[v], value)));
+            in += 4;
+            out += 4;
+        }
+    }
+#else
+    float32x4_t s[3], o[3];
+    uint32x4_t m[3];
+    for (uint32_t v = 0; v < vectors; ++v)
+    {
+        s[v] = vld1q_f32(scale + v * 4);
+        o[v] = vld1q_f32(offset + v * 4);
+        m[v] = vld1q_u32(mask + v * 4);
+    }
+
+    for (uint32_t b = 0; b < blocks; ++b)
+    {
+        for (uint32_t v = 0; v < vectors; ++v)
+        {
+            float32x4_t value = vld1q_f32(in);
+            vst1q_f32(out, vbslq_f32(m[v], vmlaq_f32(o[v], value, s[v]), value));
+            in += 4;
+            out += 4;
+        }
+    }
+#endif
+
+    return blocks * block / stride;
+}
+#endif
+
+/**
+ * Calculates the world position of a game object from its local position and world transform.
+ * @param world The world transform of the game object.
+ * @param localPosition The local position of the game object.
+ * @return The calculated world position.
+ *
+ * Specialized for each `TransformMode`. The 2D version replaces the quaternion rotation with a 2x2 rotation
+ * and falls back to the general version when the rotation is not around Z.
+ */
+template <TransformMode MODE>
+static Vector3 LocalToWorldTransform(const dmTransform::Transform& world, const Point3& localPosition);
+
+template <>
+Vector3 LocalToWorldTransform<TRANSFORM_GENERAL>(const dmTransform::Transform& world, const Point3& localPosition)
+{
+    Vector3 vecResult = mulPerElem(Vector3(localPosition), world.GetScale());
+
+    vecResult = dmVMath::Rotate(world.GetRotation(), vecResult);
+
+    return vecResult + world.GetTranslation();
+}
+
+template <>
+Vector3 LocalToWorldTransform<TRANSFORM_2D>(const dmTransform::Transform& world, const Point3& localPosition)
+{
+    const Quat rotation = world.GetRotation();
+    if (rotation.getX() != 0.0f || rotation.getY() != 0.0f)
+    {
+        return LocalToWorldTransform<TRANSFORM_GENERAL>(world, localPosition);
+    }
+
+    // A unit quaternion around Z rotates by the angle whose cosine is w^2 - z^2 and sine 2wz
+    float w = rotation.getW(), z = rotation.getZ();
+    float cosAngle = w * w - z * z;
+    float sinAngle = 2.0f * w * z;
+
+    const Vector3 scale = world.GetScale();
+    const Vector3 translation = world.GetTranslation();
+    float x = localPosition.getX() * scale.getX();
+    float y = localPosition.getY() * scale.getY();
+    return Vector3(cosAngle * x - sinAngle * y + translation.getX(),
+                   sinAngle * x + cosAngle * y + translation.getY(),
+                   localPosition.getZ() * scale.getZ() + translation.getZ());
+}
+
+/**
+ * Calculates the local position of a game object by combining its local and world positions, then
+ * applying the inverse of its world rotation and scale.
+ * @param world The world transform of the game object.
+ * @param localPosition The local position of the game object.
+ * @return The calculated local position.
+ *
+ * Both versions read the rotation and scale from a single world transform query. The scale is divided rather
+ * than inverted, so an object scaled to 0 (e.g. by a pop-in animation) gives inf/NaN instead of failing an assert.
+ * The 2D version rotates back with a 2x2 rotation, falling back to the general version like `LocalToWorldTransform`.
+ */
+template <TransformMode MODE>
+static Vector3 WorldToLocalTransform(const dmTransform::Transform& world, const Point3& localPosition);
+
+template <>
+Vector3 WorldToLocalTransform<TRANSFORM_GENERAL>(const dmTransform::Transform& world, const Point3& localPosition)
+{
+    // Combine the local position and world position to get the final position in the world space
+    Vector3 vecResult = Vector3(localPosition) + world.GetTranslation();
+
+    // Apply the inverse rotation to the position to get the position in the local space
+    vecResult = dmVMath::Rotate(conj(world.GetRotation()), vecResult);
+
+    // Adjust the position based on the object's scale
+    return divPerElem(vecResult, world.GetScale());
+}
+
+template <>
+Vector3 WorldToLocalTransform<TRANSFORM_2D>(const dmTransform::Transform& world, const Point3& localPosition)
+{
+    const Quat rotation = world.GetRotation();
+    if (rotation.getX() != 0.0f || rotation.getY() != 0.0f)
+    {
+        return WorldToLocalTransform<TRANSFORM_GENERAL>(world, localPosition);
+    }
+
+    // Rotate by the opposite angle (see LocalToWorldTransform), then undo the scale
+    float w = rotation.getW(), z = rotation.getZ();
+    float cosAngle = w * w - z * z;
+    float sinAngle = 2.0f * w * z;
+
+    const Vector3 scale = world.GetScale();
+    const Vector3 translation = world.GetTranslation();
+    float x = localPosition.getX() + translation.getX();
+    float y = localPosition.getY() + translation.getY();
+    return Vector3((cosAngle * x + sinAngle * y) / scale.getX(),
+                   (cosAngle * y - sinAngle * x) / scale.getY(),
+                   (localPosition.getZ() + translation.getZ()) / scale.getZ());
+}
+
+/**
+ * Gets the world transform and local position of a game object, through the frame-scoped cache.
+ * @param instance The game object instance.
+ * @return The transforms.
+ *
+ * The cache is keyed by the instance, which stays valid until the deferred deletions at the end of the frame,
+ * and is cleared by the next extension update. A game object moved after its first lookup of the frame
+ * therefore keeps its first transforms until then, which is why the cache is only used after `set_transform_cache(true)`.
+ */
+static CachedTransform GetInstanceTransform(dmGameObject::HInstance instance)
+{
+    TransformCache& cache = g_TransformCache;
+    dmhash_t key = (dmhash_t)(uintptr_t)instance;
+    if (cache.isEnabled)
+    {
+        const CachedTransform* cached = cache.entries.Get(key);
+        if (cached)
+        {
+            ++cache.hits;
+            return *cached;
+        }
+        ++cache.misses;
+    }
+
+    // Retrieve the world transform (rotation, position and scale) in one fetch, and the local position of the object
+    CachedTransform transform;
+    transform.world = dmGameObject::GetWorldTransform(instance);
+    transform.localPosition = dmGameObject::GetPosition(instance);
+
+    if (cache.isEnabled)
+    {
+        if (cache.entries.Full())
+        {
+            cache.entries.SetCapacity(dmMath::Max(64u, cache.entries.Capacity() * 2));
+        }
+        cache.entries.Put(key, transform);
+    }
+    return transform;
+}
+
+/**
+ * Calculates the world position of a game object from its local position, world position, scale and rotation.
+ * @param instance The game object instance.
+ * @return The calculated world position.
+ */
+template <TransformMode MODE>
+static Vector3 CalcLocalToWorld(dmGameObject::HInstance instance)
+{
+    const CachedTransform transform = GetInstanceTransform(instance);
+    return LocalToWorldTransform<MODE>(transform.world, transform.localPosition);
+}
+
+/**
+ * Calculates the local position of a game object. See `WorldToLocalTransform`.
+ * @param instance The game object instance.
+ * @return The calculated local position.
+ */
+template <TransformMode MODE>
+static Vector3 CalcWorldToLocal(dmGameObject::HInstance instance)
+{
+    const CachedTransform transform = GetInstanceTransform(instance);
+    return WorldToLocalTransform<MODE>(transform.world, transform.localPosition);
+}
+
+/**
+ * Gets the transform mode of a conversion from an optional Lua argument.
+ * @param L The Lua state.
+ * @param index The stack index of the mode.
+ * @param camera The camera whose mode is used when the argument is nil.
+ * @return The transform mode.
+ */
+static TransformMode CheckTransformMode(lua_State* L, int index, const Camera& camera)
+{
+    if (lua_isnoneornil(L, index))
+    {
+        return camera.transformMode;
+    }
+    return luaL_checkinteger(L, index) == TRANSFORM_2D ? TRANSFORM_2D : TRANSFORM_GENERAL;
+}
+
+/**
+ * Writes a position for every game object of a Lua array into a buffer stream.
+ * @param L The Lua state, with the instance array, the buffer and the stream name at index 1, 2 and 3.
+ * @param calc The function computing the position of a single instance.
+ * @return The number of written positions.
+ */
+static uint32_t WriteInstancePositions(lua_State* L, Vector3 (*calc)(dmGameObject::HInstance))
+{
+    luaL_checktype(L, 1, LUA_TTABLE);
+    dmBuffer::HBuffer outBuffer = dmScript::CheckBufferUnpack(L, 2);
+    dmhash_t outStreamName = dmScript::CheckHashOrString(L, 3);
+
+    float* out = 0;
+    uint32_t outCount = 0, outComponents = 0, outStride = 0;
+    CheckFloatStream(L, outBuffer, outStreamName, 2, &out, &outCount, &outComponents, &outStride);
+
+    uint32_t count = dmMath::Min((uint32_t)lua_objlen(L, 1), outCount);
+    bool writeZ = outComponents > 2;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        lua_rawgeti(L, 1, i + 1);
+        dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, -1);
+        lua_pop(L, 1);
+
+        const Vector3 position = calc(instance);
+        out[0] = position.getX();
+        out[1] = position.getY();
+        if (writeZ)
+        {
+            out[2] = position.getZ();
+        }
+        out += outStride;
+    }
+
+    dmBuffer::UpdateContentVersion(outBuffer);
+    return count;
+}
+
+/**
+ * Initializes a camera with the given camera and world target game objects, and sets the window size.
+ * 
+ * @param URL|ID cam The game object instance for the camera.
+ * @param URL|ID world The game object instance for the world target.
+ * @param number width The width of the window.
+ * @param number height The height of the window.
+ * 
+ * @return 1 The handle of the camera.
+ * 
+ * This function is called to set up a camera, assigning game objects to the camera and world target,
+ * and updating the window dimensions. The camera's world scale is also set based on the world target's scale.
+ * It then calls the `Resize` function to update the camera view. The new camera becomes the current camera;
+ * initializing an already initialized camera object reuses its handle.
+ *
+ * The camera is released when its camera or world target game object is deleted, or when their collection
+ * is unloaded.
+ *
+ * The camera only scales the world target until `set_position`, `follow`, `zoom_to_point` or `set_bounds` is
+ * used; scripts panning by moving the world target themselves keep working. From then on the camera owns the
+ * translation of the world target and rewrites it every frame the view changes.
+ */
+static int InitCamera(lua_State* L)
+{
+    // Get the game object instances for the camera and world target from the Lua stack
+    dmGameObject::HInstance cam = dmScript::CheckGOInstance(L, 1);
+    dmGameObject::HInstance world = dmScript::CheckGOInstance(L, 2);
+
+    // Reuse the camera already driving this game object, if any
+    uint32_t handle = INVALID_CAMERA_HANDLE;
+    for (uint32_t i = 0; i < MAX_CAMERAS; ++i)
+    {
+        Camera* existing = GetCamera(g_State.handles[i]);
+        if (existing && existing->mainCam == cam)
+        {
+            handle = g_State.handles[i];
+            break;
+        }
+    }
+
+    if (handle == INVALID_CAMERA_HANDLE)
+    {
+        handle = AllocCamera();
+        if (handle == INVALID_CAMERA_HANDLE)
+        {
+            return luaL_error(L, "Unable to create more than %d cameras", MAX_CAMERAS);
+        }
+    }
+
+    Camera camera;
+    
+    // Get the window width and height from the Lua stack
+    camera.windowWidth = lua_tonumber(L, 3);
+    camera.windowHeight = lua_tonumber(L, 4);
+
+    // Log the initialized window size
+    dmLogInfo("InitCamera: %f %f", camera.windowWidth, camera.windowHeight);
+    
+    // Store the provided instances
+    camera.mainCam = cam;
+    camera.worldTarget = world;
+    camera.mainCamCollection = dmGameObject::GetCollection(cam);
+    camera.mainCamId = dmGameObject::GetIdentifier(cam);
+    camera.worldTargetCollection = dmGameObject::GetCollection(world);
+    camera.worldTargetId = dmGameObject::GetIdentifier(world);
+    WatchCollection(camera.mainCamCollection);
+    WatchCollection(camera.worldTargetCollection);
+
+    // Get the scale of the world target and use it as the world scale
+    camera.zoom = dmGameObject::GetScale(world).getX();
+
+    // Resize the camera's viewport based on the initial window size
+    Resize(camera, camera.windowWidth, camera.windowHeight);
+
+    // Keep the world target where it is: the camera looks at the world point currently at the screen center
+    camera.position = GetPositionFromTarget(camera);
+
+    g_Cameras[handle & 0xffff] = camera;
+    FlushCamera(g_Cameras[handle & 0xffff]);
+
+    // Make it the current camera
+    g_State.current = handle;
+
+    lua_pushnumber(L, handle);
+    return 1;
+}
+
+/**
+ * Sets the zoom level of the camera and updates the world target's scale accordingly.
+ * @param number zoom The new zoom level for the camera. Must be positive.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 0 This function does not return any value.
+ */
+static int Zoom(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 2);
+    if (!camera)
+    {
+        return 0;
+    }
+
+    float zoom = luaL_checknumber(L, 1);
+    if (zoom <= 0.0f)
+    {
+        return luaL_error(L, "The zoom must be positive");
+    }
+
+    camera->zoom = zoom;
+    camera->isZooming = false;
+    InvalidateView(*camera);
+    FlushCamera(*camera);
+    return 0;
+}
+
+/**
+ * Applies an easing curve.
+ * @param easing The easing curve.
+ * @param t The linear progress in [0, 1].
+ * @return The eased progress.
+ */
+static float Ease(Easing easing, float t)
+{
+    switch (easing)
+    {
+        case EASING_IN_OUT_SINE:
+            return 0.5f - 0.5f * cosf(3.14159265f * t);
+        case EASING_OUT_CUBIC:
+        {
+            float u = 1.0f - t;
+            return 1.0f - u * u * u;
+        }
+        case EASING_IN_OUT_CUBIC:
+        {
+            if (t < 0.5f)
+            {
+                return 4.0f * t * t * t;
+            }
+            float u = 2.0f - 2.0f * t;
+            return 1.0f - u * u * u * 0.5f;
+        }
+        default:
+            return t;
+    }
+}
+
+/**
+ * Sets the zoom while keeping the world position under the zoom anchor at the same screen position.
+ * @param camera The camera to zoom.
+ * @param zoom The new zoom level.
+ */
+static void SetAnchoredZoom(Camera& camera, float zoom)
+{
+    camera.zoom = zoom;
+
+    // Screen offsets scale by the plane scale of the new zoom once projected into the world
+    float planeScale = GetPlaneScale(camera, zoom);
+    camera.position.setX(camera.zoomAnchorWorld.getX() - camera.zoomAnchorX * planeScale);
+    camera.position.setY(camera.zoomAnchorWorld.getY() - camera.zoomAnchorY * planeScale);
+    InvalidateView(camera);
+}
+
+/**
+ * Advances the zoom tween of a camera.
+ * @param camera The camera to update.
+ * @param dt The time step in seconds.
+ */
+static void UpdateZoom(Camera& camera, float dt)
+{
+    camera.zoomElapsed += dt;
+
+    float t = dmMath::Min(camera.zoomElapsed / camera.zoomDuration, 1.0f);
+    SetAnchoredZoom(camera, camera.zoomFrom + (camera.zoomTo - camera.zoomFrom) * Ease(camera.zoomEasing, t));
+
+    if (t >= 1.0f)
+    {
+        camera.isZooming = false;
+    }
+}
+
+/**
+ * Zooms while keeping a screen position fixed, e.g. the center of a pinch gesture, optionally over time.
+ * @param number zoom The new zoom level.
+ * @param vector3 anchor The screen position (relative to the screen center, like `screen_to_world`) to keep fixed.
+ * @param number [duration] The duration of the transition in seconds. Defaults to 0 (immediate).
+ * @param number [easing] The easing curve, one of the `bococam.EASING_*` constants. Defaults to `bococam.EASING_LINEAR`.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 0 This function does not return any value.
+ *
+ * The tween is advanced in the extension update. Calling `zoom` or `zoom_to_point` again replaces it.
+ */
+static int ZoomToPoint(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 5);
+    if (!camera)
+    {
+        return 0;
+    }
+
+    float zoom = luaL_checknumber(L, 1);
+    const Vector3* anchor = dmScript::CheckVector3(L, 2);
+    float duration = luaL_optnumber(L, 3, 0.0f);
+    int easing = luaL_optinteger(L, 4, EASING_LINEAR);
+    if (zoom <= 0.0f)
+    {
+        return luaL_error(L, "The zoom must be positive");
+    }
+
+    // Remember the world position currently under the anchor
+    TakeTranslation(*camera);
+    UpdateView(*camera);
+    camera->zoomAnchorX = anchor->getX();
+    camera->zoomAnchorY = anchor->getY();
+    camera->zoomAnchorWorld = Point3((camera->invView * Point3(anchor->getX(), anchor->getY(), 0.0f)).getXYZ());
+
+    if (duration <= 0.0f)
+    {
+        camera->isZooming = false;
+        SetAnchoredZoom(*camera, zoom);
+        FlushCamera(*camera);
+        return 0;
+    }
+
+    camera->isZooming = true;
+    camera->zoomFrom = camera->zoom;
+    camera->zoomTo = zoom;
+    camera->zoomElapsed = 0.0f;
+    camera->zoomDuration = duration;
+    camera->zoomEasing = (Easing)dmMath::Clamp(easing, (int)EASING_LINEAR, (int)EASING_IN_OUT_CUBIC);
+    return 0;
+}
+
+/**
+ * Moves the camera so the given world position is shown at the center of the screen.
+ * @param vector3 position The world position to look at.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 0 This function does not return any value.
+ */
+static int SetPosition(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 2);
+    if (!camera)
+    {
+        return 0;
+    }
+
+    const Vector3* position = dmScript::CheckVector3(L, 1);
+    camera->position = Point3(position->getX(), position->getY(), 0.0f);
+    camera->ownsTranslation = true;
+    InvalidateView(*camera);
+    FlushCamera(*camera);
+    return 0;
+}
+
+/**
+ * Gets the world position shown at the center of the screen.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @param vector3 [out] A vector receiving the result, returned instead of a new vector.
+ * @return 1 The camera position, kept inside the level bounds, or nil if the camera system is inactive.
+ */
+static int GetPosition(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 1);
+    if (!camera)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    // The position is clamped to the bounds when the view is rebuilt
+    UpdateView(*camera);
+    PushVector3Result(L, 2, Vector3(camera->position));
+    return 1;
+}
+
+/**
+ * Releases a camera and its game objects, freeing its camera slot.
+ * 
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * 
+ * @return 0 This function does not return any value.
+ * 
+ * This function invalidates the camera handle. If the released camera was the current camera,
+ * the camera system becomes inactive until another camera is initialized or selected.
+ */
+// Function to release the camera and reset the state
+static int ReleaseCamera(lua_State* L)
+{
+    uint32_t handle = lua_isnoneornil(L, 1) ? g_State.current : (uint32_t)luaL_checknumber(L, 1);
+    Camera* camera = GetCamera(handle);
+    if (!camera)
+    {
+        return 0;
+    }
+
+    FreeCamera(handle);
+    return 0;
+}
+
+/**
+ * Selects the camera used by the functions that are not given an explicit camera handle.
+ * 
+ * @param number camera The camera handle.
+ * 
+ * @return 0 This function does not return any value.
+ */
+static int SetCamera(lua_State* L)
+{
+    uint32_t handle = (uint32_t)luaL_checknumber(L, 1);
+    if (!GetCamera(handle))
+    {
+        return luaL_error(L, "Invalid camera handle");
+    }
+
+    g_State.current = handle;
+    return 0;
+}
+
+/**
+ * Gets the handle of the current camera.
+ * 
+ * @return 1 The handle of the current camera, or nil if no camera is active.
+ */
+static int GetCameraHandle(lua_State* L)
+{
+    if (!GetCurrentCamera())
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    lua_pushnumber(L, g_State.current);
+    return 1;
+}
+
+/**
+ * Resizes the camera's window and updates the camera view accordingly.
+ * 
+ * @param number width The new width of the window.
+ * @param number height The new height of the window.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * 
+ * @return 0 This function does not return any value.
+ * 
+ * This function updates the camera window dimensions and calls the `Resize` function to adjust the camera's
+ * viewport and world target scaling based on the new window size.
+ */
+static int ResizeCamera(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 3);
+    if (!camera)
+    {
+        return 0;
+    }
+
+    // Get the new window size from the Lua stack
+    camera->windowWidth = lua_tonumber(L, 1);
+    camera->windowHeight = lua_tonumber(L, 2);
+    
+    // Resize the camera's viewport based on the new window size
+    Resize(*camera, camera->windowWidth, camera->windowHeight);
+    FlushCamera(*camera);
+    return 0;
+}
+
+/**
+ * Enables or disables the pixel-perfect mode of a camera.
+ *
+ * @param boolean enabled True to use an integer display scale and snap the view to whole pixels.
+ * @param boolean [fractional] True to report the remaining fractional scale, for a render target upscale, with
+ * `get_pixel_scale`. Defaults to false (the remaining border is left empty).
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ *
+ * @return 0 This function does not return any value.
+ *
+ * The display scale becomes the largest integer fitting the window (or 1/n when the window is smaller than the
+ * display). The world target, the parallax layers and the camera object are moved by whole pixels only, which
+ * removes the shimmer of pixel art. The camera position itself is not rounded, so following stays smooth.
+ */
+static int SetPixelPerfect(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 3);
+    if (!camera)
+    {
+        return 0;
+    }
+
+    camera->pixelPerfect = lua_toboolean(L, 1);
+    camera->fractionalUpscale = lua_toboolean(L, 2);
+
+    // Recompute the display scale for the current window
+    Resize(*camera, camera->windowWidth, camera->windowHeight);
+    FlushCamera(*camera);
+    return 0;
+}
+
+/**
+ * Gets the display scale of a camera, and the upscale left to the render script in pixel-perfect mode.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 2 The display scale and the upscale (1 unless pixel-perfect with a fractional upscale), or nil if the
+ * camera system is inactive.
+ *
+ * With a fractional upscale, the render script draws the world at the display scale into a render target
+ * and draws that target scaled by the upscale.
+ */
+static int GetPixelScale(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 1);
+    if (!camera)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    lua_pushnumber(L, camera->aspect);
+    lua_pushnumber(L, camera->upscale);
+    return 2;
+}
+
+/**
+ * Sets the policy mapping the display size of game.project to the window.
+ * @param number mode One of the `bococam.SCALE_*` constants. `SCALE_EXPAND` (default) fits the display and shows
+ * more of the world on the longer side, `SCALE_FIT` letterboxes it, `SCALE_FILL` covers the window and crops it,
+ * and `SCALE_STRETCH` stretches it non-uniformly.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 0 This function does not return any value.
+ *
+ * The render script reads the result with `get_viewport` and `get_projection`. In stretch mode, the screen positions
+ * of the conversion functions are in display units rather than window pixels.
+ */
+static int SetScaleMode(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 2);
+    if (!camera)
+    {
+        return 0;
+    }
+
+    camera->scaleMode = (ScaleMode)dmMath::Clamp((int)luaL_checkinteger(L, 1), (int)SCALE_EXPAND, (int)SCALE_STRETCH);
+    Resize(*camera, camera->windowWidth, camera->windowHeight);
+    FlushCamera(*camera);
+    return 0;
+}
+
+/**
+ * Gets the area of the window the camera renders to, for `render.set_viewport`.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 4 The x, y, width and height of the viewport in window pixels, or nil if the camera system is inactive.
+ */
+static int GetViewport(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 1);
+    if (!camera)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    lua_pushnumber(L, camera->viewportX);
+    lua_pushnumber(L, camera->viewportY);
+    lua_pushnumber(L, camera->viewportWidth);
+    lua_pushnumber(L, camera->viewportHeight);
+    return 4;
+}
+
+/**
+ * Gets the projection of the camera, for `render.set_projection` together with the view of the camera object.
+ * @param number [near] The near plane. Defaults to -1, or to the near plane of the camera in perspective mode.
+ * @param number [far] The far plane. Defaults to 1, or to the far plane of the camera in perspective mode.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 1 The orthographic projection of the screen onto the viewport, or the perspective projection set by
+ * `set_perspective`. Nil if the camera system is inactive.
+ */
+static int GetProjection(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 3);
+    if (!camera)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    if (camera->isPerspective)
+    {
+        float nearZ = luaL_optnumber(L, 1, camera->nearZ);
+        float farZ = luaL_optnumber(L, 2, camera->farZ);
+        PushNewMatrix4(L, GetPerspectiveProjection(*camera, nearZ, farZ));
+        return 1;
+    }
+
+    float nearZ = luaL_optnumber(L, 1, -1.0f);
+    float farZ = luaL_optnumber(L, 2, 1.0f);
+    PushNewMatrix4(L, Matrix4::orthographic(0.0f, camera->halfWidth * 2.0f, 0.0f, camera->halfHeight * 2.0f, nearZ, farZ));
+    return 1;
+}
+
+/**
+ * Switches a camera to a perspective projection, for 2.5D levels.
+ * @param number [fov] The vertical field of view, in radians. Defaults to 45 degrees.
+ * @param number [near] The near plane distance. Defaults to 1.
+ * @param number [far] The far plane distance. Defaults to 10000.
+ * @param number [plane_z] The Z of the world plane hit by screen positions. Defaults to 0.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 0 This function does not return any value.
+ *
+ * Objects at Z 0 keep their orthographic size and position, nearer objects grow and farther ones shrink.
+ * `screen_to_world` and the other screen to world conversions cast a ray through the screen position and
+ * return where it hits the plane at `plane_z`, with a Z of `plane_z` whenever the result has one.
+ * `world_to_screen` and `world_to_screen_batch` with a stream of 3 or more components project every position
+ * at its own depth, while `world_to_screen_xy` and 2 component streams take the positions to lie on the plane.
+ * Zoom anchoring, bounds and the follow dead zone are measured on the plane as well. The render script gets
+ * the projection from `get_projection`.
+ */
+static int SetPerspective(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 5);
+    if (!camera)
+    {
+        return 0;
+    }
+
+    float fov = luaL_optnumber(L, 1, PERSPECTIVE_FOV);
+    float nearZ = luaL_optnumber(L, 2, PERSPECTIVE_NEAR_Z);
+    float farZ = luaL_optnumber(L, 3, PERSPECTIVE_FAR_Z);
+    if (fov <= 0.0f || fov >= PERSPECTIVE_MAX_FOV || nearZ <= 0.0f || farZ <= nearZ)
+    {
+        return luaL_error(L, "Invalid perspective: fov must be in ]0, pi[ and 0 < near < far");
+    }
+
+    camera->isPerspective = true;
+    camera->fov = fov;
+    camera->nearZ = nearZ;
+    camera->farZ = farZ;
+    camera->planeZ = luaL_optnumber(L, 4, 0.0f);
+    InvalidateView(*camera);
+    FlushCamera(*camera);
+    return 0;
+}
+
+/**
+ * Switches a camera back to the orthographic projection.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 0 This function does not return any value.
+ */
+static int SetOrthographic(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 1);
+    if (!camera)
+    {
+        return 0;
+    }
+
+    camera->isPerspective = false;
+    InvalidateView(*camera);
+    FlushCamera(*camera);
+    return 0;
+}
+
+/**
+ * Converts every position of a float32 buffer stream between screen and world space.
+ * @param L The Lua state, with the buffer, stream, optional output buffer and optional output stream at index 1 to 4.
+ * When converting to the screen, index 5 may name a uint8 stream of the output buffer receiving 1 for the results
+ * inside the screen, and 0 for the others.
+ * @param camera The camera, with up to date matrices.
+ * @param isToScreen True to convert world positions to the screen, false for the opposite.
+ * @return The number of converted positions.
+ *
+ * Positions are multiplied by the view or inverse view, an affine 2D matrix (a scale and a translation), and the
+ * Z component is left untouched (and copied when writing to another stream). Packed streams are converted with
+ * SSE2 or NEON when the target supports it. In perspective mode, world positions with a Z component are projected
+ * at their own depth instead, and world results with a Z component are placed on the world plane; see `set_perspective`.
+ */
+static uint32_t TransformStreams(lua_State* L, const Camera& camera, bool isToScreen)
+{
+    const Matrix4& matrix = isToScreen ? camera.view : camera.invView;
+
+    dmBuffer::HBuffer inBuffer = dmScript::CheckBufferUnpack(L, 1);
+    dmhash_t inStreamName = dmScript::CheckHashOrString(L, 2);
+    dmBuffer::HBuffer outBuffer = lua_isnoneornil(L, 3) ? inBuffer : dmScript::CheckBufferUnpack(L, 3);
+    dmhash_t outStreamName = lua_isnoneornil(L, 4) ? inStreamName : dmScript::CheckHashOrString(L, 4);
+
+    float* in = 0;
+    uint32_t inCount = 0, inComponents = 0, inStride = 0;
+    CheckFloatStream(L, inBuffer, inStreamName, 2, &in, &inCount, &inComponents, &inStride);
+
+    float* out = 0;
+    uint32_t outCount = 0, outComponents = 0, outStride = 0;
+    CheckFloatStream(L, outBuffer, outStreamName, 2, &out, &outCount, &outComponents, &outStride);
+
+    uint32_t count = dmMath::Min(inCount, outCount);
+
+    uint8_t* flags = 0;
+    uint32_t flagCount = 0, flagComponents = 0, flagStride = 0;
+    if (isToScreen && !lua_isnoneornil(L, 5))
+    {
+        CheckStream(L, outBuffer, dmScript::CheckHashOrString(L, 5), dmBuffer::VALUE_TYPE_UINT8, 1, (void**)&flags, &flagCount, &flagComponents, &flagStride);
+        count = dmMath::Min(count, flagCount);
+    }
+
+    bool copyZ = in != out && inComponents > 2 && outComponents > 2;
+    bool isProjected = isToScreen && camera.isPerspective && inComponents > 2;
+    bool isOnPlane = !isToScreen && camera.isPerspective && outComponents > 2;
+    float* result = out;
+
+    // The kernel copies the components after Y, which matches the scalar loop when converting in place
+    // or between two packed streams of the same layout. Interleaved streams hold other data between the
+    // points, which the kernel must not touch, so they always take the scalar loop.
+    uint32_t first = 0;
+    bool packed = inStride == inComponents && outStride == outComponents && inComponents == outComponents && (in == out || inComponents <= 3);
+    if (g_AffineKernel && packed && inStride == outStride && !isProjected)
+    {
+        first = g_AffineKernel(in, out, count, inStride, matrix.getElem(0, 0), matrix.getElem(1, 1), matrix.getElem(3, 0), matrix.getElem(3, 1));
+        in += first * inStride;
+        out += first * outStride;
+    }
+
+    for (uint32_t i = first; i < count; ++i)
+    {
+        if (isProjected)
+        {
+            const Vector4 clip = camera.viewProj * Point3(in[0], in[1], in[2]);
+            float invW = 1.0f / clip.getW();
+            out[0] = clip.getX() * invW * camera.halfWidth;
+            out[1] = clip.getY() * invW * camera.halfHeight;
+        }
+        else
+        {
+            const Vector4 position = matrix * Point3(in[0], in[1], 0.0f);
+            out[0] = position.getX();
+            out[1] = position.getY();
+        }
+        if (copyZ)
+        {
+            out[2] = in[2];
+        }
+        in += inStride;
+        out += outStride;
+    }
+
+    if (isOnPlane)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            result[i * outStride + 2] = camera.planeZ;
+        }
+    }
+
+    if (flags)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            *flags = fabsf(result[0]) <= camera.halfWidth && fabsf(result[1]) <= camera.halfHeight;
+            result += outStride;
+            flags += flagStride;
+        }
+    }
+
+    dmBuffer::UpdateContentVersion(outBuffer);
+    return count;
+}
+
+/**
+ * Converts a screen position to a world position using the camera zoom.
+ * @param vector3 position The screen position.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @param vector3 [out] A vector receiving the result, returned instead of a new vector. May be `position`.
+ * @return 1 The world position, or nil if the camera system is inactive.
+ */
+static int ScreenToWorld(lua_State* L)
+{
+    // Check if the camera system is active
+    Camera* camera = CheckCamera(L, 2);
+    if (!camera)
+    {
+        // If inactive, return nil to the Lua stack
+        lua_pushnil(L);
+        return 1;
+    }
+    
+    UpdateView(*camera);
+
+    // Single multiply with the cached inverse view
+    Vector3 result = (camera->invView * Point3(*dmScript::CheckVector3(L, 1))).getXYZ();
+    if (camera->isPerspective)
+    {
+        // The screen ray hits the world plane
+        result.setZ(camera->planeZ);
+    }
+
+    PushVector3Result(L, 3, result);
+    return 1;
+}
+
+/**
+ * Converts a screen position to a world position without creating any Lua object.
+ * @param number x The X screen position.
+ * @param number y The Y screen position.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 2 The X and Y world positions, or nil if the camera system is inactive.
+ */
+static int ScreenToWorldXY(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 3);
+    if (!camera)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    UpdateView(*camera);
+    const Vector4 world = camera->invView * Point3(luaL_checknumber(L, 1), luaL_checknumber(L, 2), 0.0f);
+    lua_pushnumber(L, world.getX());
+    lua_pushnumber(L, world.getY());
+    return 2;
+}
+
+/**
+ * Converts every screen position stored in a buffer stream to world space in a single call.
+ *
+ * @param buffer buffer The buffer holding the screen positions.
+ * @param hash|string stream The float32 stream (2 or 3 components) to read the screen positions from.
+ * @param buffer [out_buffer] The buffer to write the world positions to. Defaults to `buffer` (in place).
+ * @param hash|string [out_stream] The float32 stream to write the world positions to. Defaults to `stream`.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ *
+ * @return 1 The number of converted positions, or nil if the camera system is inactive.
+ *
+ * Every element is multiplied by the cached inverse view of the camera, without creating any Lua values.
+ * The Z component is left untouched (and copied when writing to another stream). Packed streams are converted
+ * with SSE2 or NEON when the target supports it.
+ */
+static int ScreenToWorldBatch(lua_State* L)
+{
+    // Check if the camera system is active
+    Camera* camera = CheckCamera(L, 5);
+    if (!camera)
+    {
+        // If inactive, return nil to the Lua stack
+        lua_pushnil(L);
+        return 1;
+    }
+
+    UpdateView(*camera);
+    lua_pushinteger(L, TransformStreams(L, *camera, false));
+    return 1;
+}
+
+/**
+ * Converts a world position to a screen position, relative to the center of the screen like `screen_to_world`.
+ * @param vector3 position The world position.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @param vector3 [out] A vector receiving the result, returned instead of a new vector. May be `position`.
+ * @return 1 The screen position, or nil if the camera system is inactive.
+ */
+static int WorldToScreen(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 2);
+    if (!camera)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    UpdateView(*camera);
+    const Point3 position(*dmScript::CheckVector3(L, 1));
+    if (camera->isPerspective)
+    {
+        // Project the point at its own depth rather than on the world plane
+        const Vector4 clip = camera->viewProj * position;
+        float invW = 1.0f / clip.getW();
+        PushVector3Result(L, 3, Vector3(clip.getX() * invW * camera->halfWidth, clip.getY() * invW * camera->halfHeight, position.getZ()));
+        return 1;
+    }
+
+    PushVector3Result(L, 3, (camera->view * position).getXYZ());
+    return 1;
+}
+
+/**
+ * Converts a world position to a screen position without creating any Lua object.
+ * @param number x The X world position.
+ * @param number y The Y world position.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 2 The X and Y screen positions, or nil if the camera system is inactive.
+ *
+ * In perspective mode the position is taken to lie on the world plane, see `set_perspective`.
+ */
+static int WorldToScreenXY(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 3);
+    if (!camera)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    UpdateView(*camera);
+    const Vector4 screen = camera->view * Point3(luaL_checknumber(L, 1), luaL_checknumber(L, 2), 0.0f);
+    lua_pushnumber(L, screen.getX());
+    lua_pushnumber(L, screen.getY());
+    return 2;
+}
+
+/**
+ * Converts every world position stored in a buffer stream to screen space in a single call, e.g. to place
+ * damage numbers or quest markers.
+ *
+ * @param buffer buffer The buffer holding the world positions.
+ * @param hash|string stream The float32 stream (2 or 3 components) to read the world positions from.
+ * @param buffer [out_buffer] The buffer to write the screen positions to. Defaults to `buffer` (in place).
+ * @param hash|string [out_stream] The float32 stream to write the screen positions to. Defaults to `stream`.
+ * @param hash|string [flag_stream] A uint8 stream of `out_buffer` receiving 1 for the positions on screen and 0 for the others.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ *
+ * @return 1 The number of converted positions, or nil if the camera system is inactive.
+ *
+ * The inverse of `screen_to_world_batch`: every element is multiplied by the cached view of the camera.
+ */
+static int WorldToScreenBatch(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 6);
+    if (!camera)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    UpdateView(*camera);
+    lua_pushinteger(L, TransformStreams(L, *camera, true));
+    return 1;
+}
+
+/**
+ * Checks if a world position, or a sphere around it, is inside the camera view.
+ * @param vector3 position The world position to test.
+ * @param number [radius] The radius of the sphere around the position. Defaults to 0.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 1 True if visible, or nil if the camera system is inactive.
+ */
+static int IsVisible(lua_State* L)
+{
+    // Check if the camera system is active
+    Camera* camera = CheckCamera(L, 3);
+    if (!camera)
+    {
+        // If inactive, return nil to the Lua stack
+        lua_pushnil(L);
+        return 1;
+    }
+
+    UpdateView(*camera);
+
+    const Vector3* position = dmScript::CheckVector3(L, 1);
+    float radius = luaL_optnumber(L, 2, 0.0f);
+
+    lua_pushboolean(L, dmIntersection::TestFrustumSphere(camera->frustum, Point3(*position), radius));
+    return 1;
+}
+
+/**
+ * Tests every world position stored in a buffer stream against the camera view and writes the indices of the visible ones.
+ *
+ * @param buffer buffer The buffer holding the world positions.
+ * @param hash|string stream The float32 stream (2, 3 or 4 components) to read the positions from.
+ *        With 4 components, the 4th component is the radius of each sphere.
+ * @param number radius The radius used for every position when the stream has less than 4 components.
+ * @param buffer out_buffer The buffer to write the indices to.
+ * @param hash|string out_stream The uint32 stream to write the 1-based indices of the visible positions to.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ *
+ * @return 1 The number of visible positions (compacted at the start of the output stream), or nil if the
+ * camera system is inactive.
+ */
+static int GetVisible(lua_State* L)
+{
+    // Check if the camera system is active
+    Camera* camera = CheckCamera(L, 6);
+    if (!camera)
+    {
+        // If inactive, return nil to the Lua stack
+        lua_pushnil(L);
+        return 1;
+    }
+
+    dmBuffer::HBuffer inBuffer = dmScript::CheckBufferUnpack(L, 1);
+    dmhash_t inStreamName = dmScript::CheckHashOrString(L, 2);
+    float radius = luaL_checknumber(L, 3);
+    dmBuffer::HBuffer outBuffer = dmScript::CheckBufferUnpack(L, 4);
+    dmhash_t outStreamName = dmScript::CheckHashOrString(L, 5);
+
+    float* in = 0;
+    uint32_t inCount = 0, inComponents = 0, inStride = 0;
+    CheckFloatStream(L, inBuffer, inStreamName, 2, &in, &inCount, &inComponents, &inStride);
+
+    uint32_t* out = 0;
+    uint32_t outCount = 0, outComponents = 0, outStride = 0;
+    CheckStream(L, outBuffer, outStreamName, dmBuffer::VALUE_TYPE_UINT32, 1, (void**)&out, &outCount, &outComponents, &outStride);
+
+    UpdateView(*camera);
+    const dmIntersection::Frustum& frustum = camera->frustum;
+    bool hasZ = inComponents > 2;
+    bool hasRadius = inComponents > 3;
+
+    uint32_t visible = 0;
+    for (uint32_t i = 0; i < inCount && visible < outCount; ++i)
+    {
+        const Point3 position(in[0], in[1], hasZ ? in[2] : 0.0f);
+        if (dmIntersection::TestFrustumSphere(frustum, position, hasRadius ? in[3] : radius))
+        {
+            out[visible * outStride] = i + 1;
+            ++visible;
+        }
+        in += inStride;
+    }
+
+    dmBuffer::UpdateContentVersion(outBuffer);
+
+    lua_pushinteger(L, visible);
+    return 1;
+}
+
+/**
+ * Sets the border kept around the screen by the render culling frustum returned by `get_frustum`.
+ * @param number margin The margin in pixels. Objects closer than this to the screen edge are still drawn.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 0 This function does not return any value.
+ */
+static int SetCullMargin(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 2);
+    if (!camera)
+    {
+        return 0;
+    }
+
+    camera->cullMargin = luaL_checknumber(L, 1);
+    return 0;
+}
+
+/**
+ * Gets a frustum matrix covering the camera rectangle (plus the cull margin) in engine world space.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 1 The frustum matrix, or nil if the camera system is inactive.
+ *
+ * Pass it to `render.draw(predicate, { frustum = matrix, frustum_planes = render.FRUSTUM_PLANES_SIDES })`:
+ * the render list then runs each component's visibility function against it and every entry whose
+ * world position lies outside the rectangle is dropped before draw call batching.
+ *
+ * In perspective mode the matrix is the projection of `get_projection` (widened by the margin on the plane at Z 0
+ * of the camera object space) times the inverse transform of the camera game object.
+ */
+static int GetFrustum(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 1);
+    if (!camera)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    if (camera->isPerspective)
+    {
+        // Shrinking the clip space X and Y widens the frustum around the center of the screen
+        const Vector3 margin(camera->halfWidth / (camera->halfWidth + camera->cullMargin), camera->halfHeight / (camera->halfHeight + camera->cullMargin), 1.0f);
+        PushNewMatrix4(L, Matrix4::scale(margin) * GetPerspectiveProjection(*camera, camera->nearZ, camera->farZ)
+            * Inverse(dmGameObject::GetWorldMatrix(camera->mainCam)));
+        return 1;
+    }
+
+    float left, bottom, right, top;
+    GetEngineViewRect(*camera, camera->cullMargin, &left, &bottom, &right, &top);
+
+    PushNewMatrix4(L, Matrix4::orthographic(left, right, bottom, top, -1.0f, 1.0f));
+    return 1;
+}
+
+/**
+ * Retrieves the world position of a given game object by factoring in its local position, world position,
+ * scale, and rotation.
+ * @param URL|ID instance The game object instance for which the world position is requested.
+ * @param number [mode] The transform math, `bococam.TRANSFORM_GENERAL` or `bococam.TRANSFORM_2D`. Defaults to the mode of the current camera.
+ * @param vector3 [out] A vector receiving the result, returned instead of a new vector.
+ * @return 1 The function returns the calculated world position as a `Vector3` on the Lua stack.
+ */
+static int LocalToWorld(lua_State* L)
+{
+    // Check if the camera system is active
+    Camera* camera = GetCurrentCamera();
+    if (!camera)
+    {
+        // If inactive, return nil to the Lua stack
+        lua_pushnil(L);
+        return 1;
+    }
+
+    // Get the game object instance for which the world position is requested
+    dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, 1);
+
+    bool is2D = CheckTransformMode(L, 2, *camera) == TRANSFORM_2D;
+    PushVector3Result(L, 3, is2D ? CalcLocalToWorld<TRANSFORM_2D>(instance) : CalcLocalToWorld<TRANSFORM_GENERAL>(instance));
+    return 1;
+}
+
+/**
+ * Same as `local_to_world`, but returns the components instead of a vector, without creating any Lua object.
+ * @param URL|ID instance The game object instance.
+ * @param number [mode] The transform math. Defaults to the mode of the current camera.
+ * @return 3 The X, Y and Z world positions, or nil if the camera system is inactive.
+ */
+static int LocalToWorldXYZ(lua_State* L)
+{
+    Camera* camera = GetCurrentCamera();
+    if (!camera)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, 1);
+    bool is2D = CheckTransformMode(L, 2, *camera) == TRANSFORM_2D;
+    const Vector3 position = is2D ? CalcLocalToWorld<TRANSFORM_2D>(instance) : CalcLocalToWorld<TRANSFORM_GENERAL>(instance);
+    lua_pushnumber(L, position.getX());
+    lua_pushnumber(L, position.getY());
+    lua_pushnumber(L, position.getZ());
+    return 3;
+}
+
+/**
+ * Retrieves the world positions of many game objects in a single call and writes them to a buffer stream.
+ *
+ * @param table instances An array of game object instances (URL|ID) to convert.
+ * @param buffer buffer The buffer to write the world positions to.
+ * @param hash|string stream The float32 stream (2 or 3 components) to write the world positions to.
+ * @param number [mode] The transform math. Defaults to the mode of the current camera.
+ *
+ * @return 1 The number of written positions, or nil if the camera system is inactive.
+ *
+ * Each element is computed exactly like `local_to_world`, but the results are written straight into the
+ * stream, so the number of Lua/C transitions and Lua allocations no longer depends on the instance count.
+ */
+static int LocalToWorldBatch(lua_State* L)
+{
+    // Check if the camera system is active
+    Camera* camera = GetCurrentCamera();
+    if (!camera)
+    {
+        // If inactive, return nil to the Lua stack
+        lua_pushnil(L);
+        return 1;
+    }
+
+    bool is2D = CheckTransformMode(L, 4, *camera) == TRANSFORM_2D;
+    lua_pushinteger(L, WriteInstancePositions(L, is2D ? CalcLocalToWorld<TRANSFORM_2D> : CalcLocalToWorld<TRANSFORM_GENERAL>));
+    return 1;
+}
+
+/**
+ * Retrieves the world position of a given game object by factoring in its local position, world position,
+ * scale, and rotation.
+ * 
+ * @param URL|ID instance The game object instance for which the world position is requested.
+ * @param number [mode] The transform math, `bococam.TRANSFORM_GENERAL` or `bococam.TRANSFORM_2D`. Defaults to the mode of the current camera.
+ * @param vector3 [out] A vector receiving the result, returned instead of a new vector.
+ * 
+ * @return 1 The function returns the calculated world position as a `Vector3` on the Lua stack.
+ * 
+ * This function computes the final world position of the object by adding the local position to the world position.
+ * It then applies the inverse of the object's rotation and scales the result by the object's world scale.
+ * This provides the accurate world position, which is then returned to the Lua script.
+ */
+static int WorldToLocal(lua_State* L)
+{
+    // Check if the camera system is active
+    Camera* camera = GetCurrentCamera();
+    if (!camera)
+    {
+        // If inactive, return nil to the Lua stack
+        lua_pushnil(L);
+        return 1;
+    }
+
+    // Get the game object instance for which the world position is requested
+    dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, 1);
+
+    // Push the calculated local position as a vector onto the Lua stack
+    bool is2D = CheckTransformMode(L, 2, *camera) == TRANSFORM_2D;
+    PushVector3Result(L, 3, is2D ? CalcWorldToLocal<TRANSFORM_2D>(instance) : CalcWorldToLocal<TRANSFORM_GENERAL>(instance));
+    
+    return 1;
+}
+
+/**
+ * Same as `world_to_local`, but returns the components instead of a vector, without creating any Lua object.
+ * @param URL|ID instance The game object instance.
+ * @param number [mode] The transform math. Defaults to the mode of the current camera.
+ * @return 3 The X, Y and Z local positions, or nil if the camera system is inactive.
+ */
+static int WorldToLocalXYZ(lua_State* L)
+{
+    Camera* camera = GetCurrentCamera();
+    if (!camera)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, 1);
+    bool is2D = CheckTransformMode(L, 2, *camera) == TRANSFORM_2D;
+    const Vector3 position = is2D ? CalcWorldToLocal<TRANSFORM_2D>(instance) : CalcWorldToLocal<TRANSFORM_GENERAL>(instance);
+    lua_pushnumber(L, position.getX());
+    lua_pushnumber(L, position.getY());
+    lua_pushnumber(L, position.getZ());
+    return 3;
+}
+
+/**
+ * Retrieves the local positions of many game objects in a single call and writes them to a buffer stream.
+ *
+ * @param table instances An array of game object instances (URL|ID) to convert.
+ * @param buffer buffer The buffer to write the local positions to.
+ * @param hash|string stream The float32 stream (2 or 3 components) to write the local positions to.
+ * @param number [mode] The transform math. Defaults to the mode of the current camera.
+ *
+ * @return 1 The number of written positions, or nil if the camera system is inactive.
+ */
+static int WorldToLocalBatch(lua_State* L)
+{
+    // Check if the camera system is active
+    Camera* camera = GetCurrentCamera();
+    if (!camera)
+    {
+        // If inactive, return nil to the Lua stack
+        lua_pushnil(L);
+        return 1;
+    }
+
+    bool is2D = CheckTransformMode(L, 4, *camera) == TRANSFORM_2D;
+    lua_pushinteger(L, WriteInstancePositions(L, is2D ? CalcWorldToLocal<TRANSFORM_2D> : CalcWorldToLocal<TRANSFORM_GENERAL>));
+    return 1;
+}
+
+/**
+ * Enables or disables the frame-scoped transform cache of the local/world conversions.
+ * @param boolean enabled True to cache the transforms of every game object for the rest of the frame.
+ * @return 0 This function does not return any value.
+ *
+ * The cache is disabled by default, so the conversions read the live transforms. Only enable it when no
+ * script moves a game object after converting it in the same frame.
+ */
+static int SetTransformCache(lua_State* L)
+{
+    g_TransformCache.isEnabled = lua_toboolean(L, 1);
+    g_TransformCache.entries.Clear();
+    return 0;
+}
+
+/**
+ * Gets the hit and miss counts of the transform cache.
+ * @param boolean [reset] True to reset the counts after reading them.
+ * @return 2 The number of lookups served from the cache, and the number of lookups that queried the engine.
+ */
+static int GetTransformCacheStats(lua_State* L)
+{
+    lua_pushinteger(L, g_TransformCache.hits);
+    lua_pushinteger(L, g_TransformCache.misses);
+    if (lua_toboolean(L, 1))
+    {
+        g_TransformCache.hits = 0;
+        g_TransformCache.misses = 0;
+    }
+    return 2;
+}
+
+/**
+ * Gets the number of Lua objects (vectors, matrices, hashes and tables) created by the module, to check that
+ * the in-place and multi-return variants keep a frame free of garbage.
+ * @return 2 The count of the previous frame, and the count of the current frame so far.
+ */
+static int GetAllocationCount(lua_State* L)
+{
+    lua_pushinteger(L, g_State.lastAllocations);
+    lua_pushinteger(L, g_State.allocations);
+    return 2;
+}
+
+/**
+ * Sets the transform math used by the local/world conversions of a camera.
+ * @param number mode `bococam.TRANSFORM_GENERAL`, or `bococam.TRANSFORM_2D` for a 2x2 rotation when objects only rotate around Z.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 0 This function does not return any value.
+ *
+ * The 2D math still falls back to the general one for objects rotated around another axis.
+ */
+static int SetTransformMode(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 2);
+    if (!camera)
+    {
+        return 0;
+    }
+
+    camera->transformMode = luaL_checkinteger(L, 1) == TRANSFORM_2D ? TRANSFORM_2D : TRANSFORM_GENERAL;
+    return 0;
+}
+
+/**
+ * Builds the key of the grid cell holding a position.
+ * @param x The cell column.
+ * @param y The cell row.
+ * @return The cell key.
+ */
+static inline dmhash_t GridCellKey(int32_t x, int32_t y)
+{
+    return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+}
+
+/**
+ * Gets the column or row of the grid cell holding a coordinate.
+ * @param value The X or Y coordinate.
+ * @return The cell column or row, clamped to [-GRID_MAX_CELL, GRID_MAX_CELL]. NaN maps to 0.
+ *
+ * Casting a float outside the int32 range, or NaN, is undefined, so the value is clamped first.
+ */
+static inline int32_t GridCell(float value)
+{
+    float cell = floorf(value * g_Grid.invCellSize);
+    if (isnan(cell))
+    {
+        return 0;
+    }
+    return (int32_t)dmMath::Clamp(cell, -GRID_MAX_CELL, GRID_MAX_CELL);
+}
+
+/**
+ * Builds the key of a tracked object from its collection and identifier.
+ * @param collection The collection owning the game object.
+ * @param id The identifier of the game object.
+ * @return The object key.
+ */
+static dmhash_t GridObjectKey(dmGameObject::HCollection collection, dmhash_t id)
+{
+    const uint64_t data[2] = { (uint64_t)(uintptr_t)collection, id };
+    return dmHashBuffer64(data, sizeof(data));
+}
+
+/**
+ * Removes a tracked object from the grid, keeping the object array dense.
+ * @param index The index of the object to remove.
+ */
+static void GridRemove(uint32_t index)
+{
+    g_Grid.objectIndices.Erase(g_Grid.objects[index].key);
+    g_Grid.objects.EraseSwap(index);
+    if (index < g_Grid.objects.Size())
+    {
+        g_Grid.objectIndices.Put(g_Grid.objects[index].key, index);
+    }
+
+    // The cell lists reference object indices, which just changed
+    g_Grid.isDirty = true;
+}
+
+/**
+ * Refreshes the world positions of the tracked objects and rebuilds the cell lists.
+ * 
+ * Objects whose game object no longer exists are removed from the grid.
+ */
+static void UpdateGrid()
+{
+    dmArray<TrackedObject>& objects = g_Grid.objects;
+
+    g_Grid.cells.Clear();
+    if (g_Grid.cells.Capacity() < objects.Size())
+    {
+        g_Grid.cells.SetCapacity(objects.Size());
+    }
+
+    g_Grid.maxRadius = 0.0f;
+    uint32_t i = 0;
+    while (i < objects.Size())
+    {
+        TrackedObject& object = objects[i];
+        dmGameObject::HInstance instance = dmGameObject::GetInstanceFromIdentifier(object.collection, object.id);
+        if (!instance)
+        {
+            GridRemove(i);
+            continue;
+        }
+
+        object.position = dmGameObject::GetWorldPosition(instance);
+        g_Grid.maxRadius = dmMath::Max(g_Grid.maxRadius, object.radius);
+
+        dmhash_t cellKey = GridCellKey(GridCell(object.position.getX()), GridCell(object.position.getY()));
+        uint32_t* first = g_Grid.cells.Get(cellKey);
+        object.next = first ? *first : GRID_END;
+        g_Grid.cells.Put(cellKey, i);
+        ++i;
+    }
+
+    g_Grid.isDirty = false;
+}
+
+/**
+ * Checks if a tracked object overlaps a circle or a rectangle.
+ * @param object The tracked object.
+ * @param left The left edge of the queried area.
+ * @param bottom The bottom edge of the queried area.
+ * @param right The right edge of the queried area.
+ * @param top The top edge of the queried area.
+ * @param center The center of the queried circle, if `radius` is not negative.
+ * @param radius The radius of the queried circle, or a negative value to query the rectangle.
+ * @return True if the object overlaps the area.
+ */
+static inline bool GridOverlaps(const TrackedObject& object, float left, float bottom, float right, float top, const Point3& center, float radius)
+{
+    float x = object.position.getX();
+    float y = object.position.getY();
+
+    if (radius >= 0.0f)
+    {
+        float dx = x - center.getX();
+        float dy = y - center.getY();
+        float reach = radius + object.radius;
+        return dx * dx + dy * dy <= reach * reach;
+    }
+
+    // Distance from the object center to the closest point of the rectangle
+    float dx = x - dmMath::Clamp(x, left, right);
+    float dy = y - dmMath::Clamp(y, bottom, top);
+    return dx * dx + dy * dy <= object.radius * object.radius;
+}
+
+/**
+ * Pushes a Lua array with the identifiers of the tracked objects overlapping a circle or a rectangle.
+ * @param L The Lua state.
+ * @param left The left edge of the queried area.
+ * @param bottom The bottom edge of the queried area.
+ * @param right The right edge of the queried area.
+ * @param top The top edge of the queried area.
+ * @param center The center of the queried circle, if `radius` is not negative.
+ * @param radius The radius of the queried circle, or a negative value to query the rectangle.
+ *
+ * Only the cells touching the area (widened by the largest object radius) are visited, unless there are
+ * more such cells than tracked objects, in which case the objects are scanned directly.
+ */
+static void PushGridQuery(lua_State* L, float left, float bottom, float right, float top, const Point3& center, float radius)
+{
+    if (g_Grid.isDirty)
+    {
+        UpdateGrid();
+    }
+
+    lua_newtable(L);
+    ++g_State.allocations;
+    int count = 0;
+
+    const dmArray<TrackedObject>& objects = g_Grid.objects;
+    int32_t minX = GridCell(left - g_Grid.maxRadius);
+    int32_t minY = GridCell(bottom - g_Grid.maxRadius);
+    int32_t maxX = GridCell(right + g_Grid.maxRadius);
+    int32_t maxY = GridCell(top + g_Grid.maxRadius);
+
+    // 64-bit, as a span between clamped cells does not fit in an int32
+    int64_t columns = (int64_t)maxX - minX + 1;
+    int64_t rows = (int64_t)maxY - minY + 1;
+    if (columns > 0 && rows > 0 && columns * rows > (int64_t)objects.Size())
+    {
+        for (uint32_t i = 0; i < objects.Size(); ++i)
+        {
+            if (GridOverlaps(objects[i], left, bottom, right, top, center, radius))
+            {
+                PushNewHash(L, objects[i].id);
+                lua_rawseti(L, -2, ++count);
+            }
+        }
+        return;
+    }
+
+    for (int32_t y = minY; y <= maxY; ++y)
+    {
+        for (int32_t x = minX; x <= maxX; ++x)
+        {
+            uint32_t* first = g_Grid.cells.Get(GridCellKey(x, y));
+            for (uint32_t i = first ? *first : GRID_END; i != GRID_END; i = objects[i].next)
+            {
+                if (GridOverlaps(objects[i], left, bottom, right, top, center, radius))
+                {
+                    PushNewHash(L, objects[i].id);
+                    lua_rawseti(L, -2, ++count);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Registers a game object in the spatial grid so it can be found by `query_view` and `query_radius`.
+ * @param URL|ID instance The game object instance to track.
+ * @param number [radius] The radius of the object. Defaults to 0.
+ * @return 0 This function does not return any value.
+ *
+ * Tracked objects are refreshed once per frame from their world position, and dropped automatically
+ * once their game object is deleted or its collection is unloaded.
+ */
+static int Track(lua_State* L)
+{
+    dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, 1);
+    float radius = luaL_optnumber(L, 2, 0.0f);
+
+    TrackedObject object;
+    object.collection = dmGameObject::GetCollection(instance);
+    object.id = dmGameObject::GetIdentifier(instance);
+    object.key = GridObjectKey(object.collection, object.id);
+    WatchCollection(object.collection);
+    object.position = dmGameObject::GetWorldPosition(instance);
+    object.radius = radius;
+    object.next = GRID_END;
+
+    // The new object is not in any cell list yet
+    g_Grid.isDirty = true;
+
+    uint32_t* index = g_Grid.objectIndices.Get(object.key);
+    if (index)
+    {
+        g_Grid.objects[*index] = object;
+        return 0;
+    }
+
+    if (g_Grid.objects.Full())
+    {
+        g_Grid.objects.OffsetCapacity(dmMath::Max(64u, g_Grid.objects.Capacity()));
+    }
+    if (g_Grid.objectIndices.Full())
+    {
+        g_Grid.objectIndices.SetCapacity(g_Grid.objects.Capacity());
+    }
+
+    g_Grid.objectIndices.Put(object.key, g_Grid.objects.Size());
+    g_Grid.objects.Push(object);
+    return 0;
+}
+
+/**
+ * Removes a game object from the spatial grid.
+ * @param URL|ID instance The game object instance to stop tracking.
+ * @return 0 This function does not return any value.
+ */
+static int Untrack(lua_State* L)
+{
+    dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, 1);
+    dmGameObject::HCollection collection = dmGameObject::GetCollection(instance);
+
+    uint32_t* index = g_Grid.objectIndices.Get(GridObjectKey(collection, dmGameObject::GetIdentifier(instance)));
+    if (index)
+    {
+        GridRemove(*index);
+    }
+    return 0;
+}
+
+/**
+ * Sets the size of the spatial grid cells. It should be close to the typical query size.
+ * @param number size The width and height of a cell.
+ * @return 0 This function does not return any value.
+ */
+static int SetGridCellSize(lua_State* L)
+{
+    float size = luaL_checknumber(L, 1);
+    if (size <= 0.0f)
+    {
+        return luaL_error(L, "The grid cell size must be positive");
+    }
+
+    g_Grid.cellSize = size;
+    g_Grid.invCellSize = 1.0f / size;
+    UpdateGrid();
+    return 0;
+}
+
+/**
+ * Gets the tracked game objects overlapping the camera rectangle.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 1 An array with the identifiers of the visible objects, or nil if the camera system is inactive.
+ */
+static int QueryView(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 1);
+    if (!camera)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    float left, bottom, right, top;
+    GetEngineViewRect(*camera, 0.0f, &left, &bottom, &right, &top);
+    PushGridQuery(L, left, bottom, right, top, Point3(0.0f), -1.0f);
+    return 1;
+}
+
+/**
+ * Gets the tracked game objects within a distance of a world position.
+ * @param vector3 position The world position.
+ * @param number radius The distance.
+ * @return 1 An array with the identifiers of the objects in range.
+ */
+static int QueryRadius(lua_State* L)
+{
+    const Vector3* position = dmScript::CheckVector3(L, 1);
+    float radius = dmMath::Max(0.0f, (float)luaL_checknumber(L, 2));
+
+    float x = position->getX();
+    float y = position->getY();
+    PushGridQuery(L, x - radius, y - radius, x + radius, y + radius, Point3(*position), radius);
+    return 1;
+}
+
+/**
+ * Gets the position of the followed game object in the world target space (the space of `set_position`).
+ * @param camera The camera.
+ * @param out Receives the position.
+ * @return False if the followed game object no longer exists.
+ */
+static bool GetFollowTarget(const Camera& camera, Point3* out)
+{
+    dmGameObject::HInstance target = dmGameObject::GetInstanceFromIdentifier(camera.followCollection, camera.followId);
+    if (!target)
+    {
+        return false;
+    }
+
+    // Undo the world target transform; its scale is the zoom, which is always positive
+    const dmTransform::Transform world = dmGameObject::GetWorldTransform(camera.worldTarget);
+    const Vector3 position = dmGameObject::GetWorldPosition(target) - Point3(world.GetTranslation());
+    *out = Point3(divPerElem(dmVMath::Rotate(conj(world.GetRotation()), position), world.GetScale()));
+    return true;
+}
+
+/**
+ * Moves the camera position one step towards the followed game object.
+ * @param camera The camera to update.
+ * @param dt The time step in seconds.
+ *
+ * The camera ignores the target while it stays inside the dead zone, aims ahead of it by its velocity times
+ * `lookAhead`, and closes the remaining distance with a critically damped spring (no overshoot).
+ */
+static void UpdateFollow(Camera& camera, float dt)
+{
+    Point3 target;
+    if (!GetFollowTarget(camera, &target))
+    {
+        camera.isFollowing = false;
+        return;
+    }
+
+    Vector3 targetVelocity = (target - camera.lastFollowTarget) * (1.0f / dt);
+    camera.lastFollowTarget = target;
+    target += targetVelocity * camera.lookAhead;
+
+    // Only move the goal by what the target exceeds the dead zone (converted from pixels to world units)
+    float planeScale = GetPlaneScale(camera, camera.zoom);
+    float deadZoneX = camera.deadZoneX * planeScale;
+    float deadZoneY = camera.deadZoneY * planeScale;
+    Point3 goal = camera.position;
+    goal.setX(dmMath::Clamp(goal.getX(), target.getX() - deadZoneX, target.getX() + deadZoneX));
+    goal.setY(dmMath::Clamp(goal.getY(), target.getY() - deadZoneY, target.getY() + deadZoneY));
+
+    if (camera.followSmoothTime <= 0.0f)
+    {
+        camera.position = goal;
+        camera.followVelocity = Vector3(0.0f);
+    }
+    else
+    {
+        // Critically damped spring, using the polynomial approximation of exp(-omega * dt)
+        float omega = 2.0f / camera.followSmoothTime;
+        float x = omega * dt;
+        float decay = 1.0f / (1.0f + x + 0.48f * x * x + 0.235f * x * x * x);
+
+        Vector3 change = camera.position - goal;
+        change.setZ(0.0f);
+        Vector3 temp = (camera.followVelocity + change * omega) * dt;
+        camera.followVelocity = (camera.followVelocity - temp * omega) * decay;
+        camera.position = goal + (change + temp) * decay;
+    }
+
+    InvalidateView(camera);
+}
+
+/**
+ * Makes the camera follow a game object. The camera is moved natively on every extension update.
+ *
+ * @param URL|ID target The game object instance to follow.
+ * @param table [options] A table with the following optional fields:
+ *   - number `smooth_time` Time for the camera to catch up with the target. 0 (default) snaps to it.
+ *   - vector3 `dead_zone` Width and height, in pixels, of the screen area the target moves in without moving the camera.
+ *   - number `look_ahead` Time, in seconds, the camera anticipates the target movement by. Defaults to 0.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ *
+ * @return 0 This function does not return any value.
+ *
+ * Following stops when the target is deleted or its collection is unloaded.
+ */
+static int Follow(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 3);
+    if (!camera)
+    {
+        return 0;
+    }
+
+    dmGameObject::HInstance target = dmScript::CheckGOInstance(L, 1);
+    camera->followCollection = dmGameObject::GetCollection(target);
+    camera->followId = dmGameObject::GetIdentifier(target);
+    WatchCollection(camera->followCollection);
+    camera->followSmoothTime = 0.0f;
+    camera->deadZoneX = 0.0f;
+    camera->deadZoneY = 0.0f;
+    camera->lookAhead = 0.0f;
+
+    if (!lua_isnoneornil(L, 2))
+    {
+        luaL_checktype(L, 2, LUA_TTABLE);
+
+        lua_getfield(L, 2, "smooth_time");
+        camera->followSmoothTime = luaL_optnumber(L, -1, 0.0f);
+        lua_pop(L, 1);
+
+        lua_getfield(L, 2, "dead_zone");
+        if (!lua_isnil(L, -1))
+        {
+            const Vector3* deadZone = dmScript::CheckVector3(L, -1);
+            camera->deadZoneX = deadZone->getX() * HALF_MULTIPLIER;
+            camera->deadZoneY = deadZone->getY() * HALF_MULTIPLIER;
+        }
+        lua_pop(L, 1);
+
+        lua_getfield(L, 2, "look_ahead");
+        camera->lookAhead = luaL_optnumber(L, -1, 0.0f);
+        lua_pop(L, 1);
+    }
+
+    camera->isFollowing = true;
+    TakeTranslation(*camera);
+    camera->followVelocity = Vector3(0.0f);
+    GetFollowTarget(*camera, &camera->lastFollowTarget);
+    return 0;
+}
+
+/**
+ * Stops following the game object set with `follow`. The camera stays where it is.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 0 This function does not return any value.
+ */
+static int Unfollow(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 1);
+    if (camera)
+    {
+        camera->isFollowing = false;
+    }
+    return 0;
+}
+
+/**
+ * Adds trauma to the camera, making it shake. The shake fades out as the trauma decays.
+ * @param number amount The trauma to add. The total is clamped to [0, 1].
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 0 This function does not return any value.
+ */
+static int AddTrauma(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 2);
+    if (camera)
+    {
+        camera->trauma = dmMath::Clamp(camera->trauma + (float)luaL_checknumber(L, 1), 0.0f, 1.0f);
+    }
+    return 0;
+}
+
+/**
+ * Gets the current trauma of the camera.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 1 The trauma in [0, 1], or nil if the camera system is inactive.
+ */
+static int GetTrauma(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 1);
+    if (!camera)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    lua_pushnumber(L, camera->trauma);
+    return 1;
+}
+
+/**
+ * Configures the camera shake.
+ *
+ * @param table options A table with the following optional fields:
+ *   - number `max_offset` Offset, in pixels, at full trauma.
+ *   - number `max_angle` Rotation, in radians, at full trauma.
+ *   - number `frequency` Noise samples per second.
+ *   - number `decay` Trauma removed per second.
+ *   - number `seed` Noise seed. Setting it also restarts the noise, so the same seed and time steps replay the same shake.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ *
+ * @return 0 This function does not return any value.
+ */
+static int SetShake(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 2);
+    if (!camera)
+    {
+        return 0;
+    }
+
+    luaL_checktype(L, 1, LUA_TTABLE);
+
+    lua_getfield(L, 1, "max_offset");
+    camera->shakeMaxOffset = luaL_optnumber(L, -1, camera->shakeMaxOffset);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 1, "max_angle");
+    camera->shakeMaxAngle = luaL_optnumber(L, -1, camera->shakeMaxAngle);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 1, "frequency");
+    camera->shakeFrequency = luaL_optnumber(L, -1, camera->shakeFrequency);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 1, "decay");
+    camera->traumaDecay = luaL_optnumber(L, -1, camera->traumaDecay);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 1, "seed");
+    if (!lua_isnil(L, -1))
+    {
+        camera->shakeSeed = (uint32_t)luaL_checknumber(L, -1);
+        camera->shakeTime = 0.0f;
+    }
+    lua_pop(L, 1);
+
+    return 0;
+}
+
+/**
+ * Keeps the visible area of the camera inside the level. Enforced on every resize, zoom and camera move.
+ * @param number left The left edge of the level, in world target space.
+ * @param number bottom The bottom edge of the level.
+ * @param number right The right edge of the level.
+ * @param number top The top edge of the level.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 0 This function does not return any value.
+ */
+static int SetBounds(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 5);
+    if (!camera)
+    {
+        return 0;
+    }
+
+    camera->boundsLeft = luaL_checknumber(L, 1);
+    camera->boundsBottom = luaL_checknumber(L, 2);
+    camera->boundsRight = luaL_checknumber(L, 3);
+    camera->boundsTop = luaL_checknumber(L, 4);
+    camera->hasBounds = true;
+    TakeTranslation(*camera);
+    InvalidateView(*camera);
+    FlushCamera(*camera);
+    return 0;
+}
+
+/**
+ * Removes the level bounds set with `set_bounds`.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 0 This function does not return any value.
+ */
+static int ClearBounds(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 1);
+    if (camera)
+    {
+        camera->hasBounds = false;
+    }
+    return 0;
+}
+
+/**
+ * Gets a stream of the indicator buffer, if the buffer has it.
+ * @param buffer The buffer.
+ * @param name The stream name.
+ * @param valueType The required value type.
+ * @param minComponents The minimum number of components.
+ * @param count The minimum number of elements.
+ * @param stride Receives the distance between two elements, in values.
+ * @return The first element, or 0 if the stream is missing or does not match.
+ */
+static void* GetOptionalStream(dmBuffer::HBuffer buffer, const char* name, dmBuffer::ValueType valueType, uint32_t minComponents, uint32_t count, uint32_t* stride)
+{
+    dmhash_t streamName = dmHashString64(name);
+    dmBuffer::ValueType type;
+    uint32_t components = 0;
+    void* data = 0;
+    uint32_t streamCount = 0;
+    if (dmBuffer::GetStreamType(buffer, streamName, &type, &components) != dmBuffer::RESULT_OK || type != valueType || components < minComponents
+        || dmBuffer::GetStream(buffer, streamName, &data, &streamCount, &components, stride) != dmBuffer::RESULT_OK || streamCount < count)
+    {
+        return 0;
+    }
+    return data;
+}
 
-// Structure to hold the camera properties and settings
-struct Camera
+/**
+ * Registers a game object to point at with an off-screen indicator.
+ * @param URL|ID target The game object instance.
+ * @return 1 The row of the target in the buffer filled by `update_indicators`. It stays the same until the target
+ * is removed or deleted, after which the row may be reused.
+ */
+static int AddIndicator(lua_State* L)
 {
-    dmGameObject::HInstance mainCam;   // Handle to the main camera object
-    dmGameObject::HInstance worldTarget; // Handle to the world target
+    dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, 1);
 
-    float windowWidth = (float)DISPLAY_WIDTH;  // Window width for rendering
-    float windowHeight = (float)DISPLAY_HEIGHT; // Window height for rendering
+    IndicatorTarget target;
+    target.collection = dmGameObject::GetCollection(instance);
+    target.id = dmGameObject::GetIdentifier(instance);
+    target.isActive = true;
+    WatchCollection(target.collection);
 
-    float halfWidth = windowWidth * HALF_MULTIPLIER; // Half of the window width
-    float halfHeight = windowHeight * HALF_MULTIPLIER; // Half of the window height
+    // Reuse the slot of the same target, or the first free one
+    uint32_t slot = g_Indicators.Size();
+    for (uint32_t i = 0; i < g_Indicators.Size(); ++i)
+    {
+        const IndicatorTarget& other = g_Indicators[i];
+        if (other.isActive && other.collection == target.collection && other.id == target.id)
+        {
+            slot = i;
+            break;
+        }
+        if (!other.isActive && slot == g_Indicators.Size())
+        {
+            slot = i;
+        }
+    }
 
-    float zoom = 1.0f;            // Zoom level of the camera
-    float aspect = 1.0f;          // Aspect ratio of the camera
-    
-    float invZoom = 1.0f / (zoom * aspect);  // Inverse of the zoom level
+    if (slot == g_Indicators.Size())
+    {
+        if (g_Indicators.Full())
+        {
+            g_Indicators.OffsetCapacity(dmMath::Max(64u, g_Indicators.Capacity()));
+        }
+        g_Indicators.Push(target);
+    }
+    else
+    {
+        g_Indicators[slot] = target;
+    }
 
-    unsigned int displayWidth = DISPLAY_WIDTH;  // Display width
-    unsigned int displayHeight = DISPLAY_HEIGHT; // Display height
-};
+    lua_pushinteger(L, slot + 1);
+    return 1;
+}
 
-// Static global variables to hold camera and state data
-static Camera g_Camera;
-static State g_State;
+/**
+ * Stops pointing at a game object.
+ * @param URL|ID target The game object instance.
+ * @return 0 This function does not return any value.
+ */
+static int RemoveIndicator(lua_State* L)
+{
+    dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, 1);
+    dmGameObject::HCollection collection = dmGameObject::GetCollection(instance);
+    dmhash_t id = dmGameObject::GetIdentifier(instance);
+
+    for (uint32_t i = 0; i < g_Indicators.Size(); ++i)
+    {
+        if (g_Indicators[i].isActive && g_Indicators[i].collection == collection && g_Indicators[i].id == id)
+        {
+            g_Indicators[i].isActive = false;
+            break;
+        }
+    }
+
+    // Trailing free slots are dropped so the row count stays small
+    while (!g_Indicators.Empty() && !g_Indicators.Back().isActive)
+    {
+        g_Indicators.Pop();
+    }
+    return 0;
+}
 
 /**
- * Resizes the camera's viewport and adjusts the world target's scale based on the window size.
- * 
- * @param width The new width of the window.
- * @param height The new height of the window.
- * 
- * This function recalculates the scaling factor for the camera to maintain its aspect ratio
- * and applies the necessary transformations to the world target object. The scale factor is 
- * adjusted to ensure the camera view fits within the new window size.
+ * Computes the off-screen indicators of every registered target and writes them into a buffer, one row per target.
+ *
+ * @param buffer buffer The buffer to write to. It must have at least as many elements as the returned row count,
+ * and any of the following streams:
+ *   - `position`: float32 (2 or 3 components), the screen position of the indicator, relative to the center of the
+ *     screen like `world_to_screen`. It is the target position clamped to the screen edges, along the line from the center.
+ *   - `angle`: float32, the direction from the center of the screen to the target, in radians.
+ *   - `distance`: float32, the distance from the camera position to the target, in world units.
+ *   - `offscreen`: uint8, 1 if the target is outside the screen and needs an indicator, 0 otherwise (also for free rows).
+ * @param number [margin] The distance, in pixels, kept between the indicators and the screen edges. Defaults to 0.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ *
+ * @return 1 The number of rows written, or nil if the camera system is inactive.
+ *
+ * The screen position of a target comes from its engine world position relative to the camera object, so targets
+ * do not need to be children of the world target. Deleted targets, and those of unloaded collections, free their row.
  */
-static void Resize(const int& width, const int& height)
+static int UpdateIndicators(lua_State* L)
 {
-    // Calculate the scaling factors for both axes (X and Y)
-    float displayScaleX = g_Camera.windowWidth / g_Camera.displayWidth;
-    float displayScaleY = g_Camera.windowHeight / g_Camera.displayHeight;
-    
-    g_Camera.windowWidth = width;
-    g_Camera.windowHeight = height;
+    Camera* camera = CheckCamera(L, 3);
+    if (!camera)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
 
-    g_Camera.halfWidth = width * HALF_MULTIPLIER;
-    g_Camera.halfHeight = height * HALF_MULTIPLIER;
+    dmBuffer::HBuffer buffer = dmScript::CheckBufferUnpack(L, 1);
+    float margin = luaL_optnumber(L, 2, 0.0f);
 
-    // Find the minimum scale factor between X and Y, and apply the world scaling
-    g_Camera.aspect = fmin(displayScaleX, displayScaleY);
-    
-    float scaleValue = g_Camera.zoom * g_Camera.aspect;
+    uint32_t count = g_Indicators.Size();
+    uint32_t positionStride = 0, angleStride = 0, distanceStride = 0, offscreenStride = 0;
+    float* positions = (float*)GetOptionalStream(buffer, "position", dmBuffer::VALUE_TYPE_FLOAT32, 2, count, &positionStride);
+    float* angles = (float*)GetOptionalStream(buffer, "angle", dmBuffer::VALUE_TYPE_FLOAT32, 1, count, &angleStride);
+    float* distances = (float*)GetOptionalStream(buffer, "distance", dmBuffer::VALUE_TYPE_FLOAT32, 1, count, &distanceStride);
+    uint8_t* offscreen = (uint8_t*)GetOptionalStream(buffer, "offscreen", dmBuffer::VALUE_TYPE_UINT8, 1, count, &offscreenStride);
+    if (!positions && !angles && !distances && !offscreen)
+    {
+        return luaL_error(L, "The buffer needs a position, angle, distance or offscreen stream with at least %d elements", count);
+    }
 
-    // Update the inverse zoom factor
-    g_Camera.invZoom = 1.0f / scaleValue;
-    
-    // Log the calculated scale factor
-    dmLogInfo("Scale: %f", scaleValue);
+    UpdateView(*camera);
+
+    const Point3 center = GetEngineScreenCenter(*camera);
+    float edgeX = dmMath::Max(camera->halfWidth - margin, 0.0f);
+    float edgeY = dmMath::Max(camera->halfHeight - margin, 0.0f);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        IndicatorTarget& target = g_Indicators[i];
+        dmGameObject::HInstance instance = target.isActive ? dmGameObject::GetInstanceFromIdentifier(target.collection, target.id) : 0;
+        target.isActive = instance != 0;
 
-    // Set the position of the camera (shifted to center the view)
-    dmGameObject::SetPosition(g_Camera.mainCam, Point3(width * -HALF_MULTIPLIER, height * -HALF_MULTIPLIER, 0.0f));
+        float x = 0.0f, y = 0.0f;
+        bool isOffscreen = false;
+        if (instance)
+        {
+            const Point3 position = dmGameObject::GetWorldPosition(instance);
+            x = position.getX() - center.getX();
+            y = position.getY() - center.getY();
+            isOffscreen = fabsf(x) > edgeX || fabsf(y) > edgeY;
+        }
 
-    // Apply the calculated scale to the world target
-    dmGameObject::SetScale(g_Camera.worldTarget, Vector3(scaleValue));
+        if (angles)
+        {
+            angles[i * angleStride] = atan2f(y, x);
+        }
+        if (distances)
+        {
+            distances[i * distanceStride] = sqrtf(x * x + y * y) * camera->invZoom;
+        }
+        if (positions)
+        {
+            // Move the point toward the center until it lies on the inset screen rectangle
+            float scale = 1.0f;
+            if (isOffscreen)
+            {
+                scale = dmMath::Min(x != 0.0f ? edgeX / fabsf(x) : 1.0f, y != 0.0f ? edgeY / fabsf(y) : 1.0f);
+            }
+            positions[i * positionStride] = x * scale;
+            positions[i * positionStride + 1] = y * scale;
+        }
+        if (offscreen)
+        {
+            offscreen[i * offscreenStride] = isOffscreen;
+        }
+    }
+
+    dmBuffer::UpdateContentVersion(buffer);
+
+    lua_pushinteger(L, count);
+    return 1;
 }
+
 /**
- * Remaps a value from one range to another.
- * @param value The value to remap.
- * @param low1 The low end of the value's current range.
- * @param high1 The high end of the value's current range.
- * @param low2 The low end of the value's target range.
- * @param high2 The high end of the value's target range.
- * @return The remapped value.
+ * Gets the number of gui units per screen unit of a camera.
+ * @param camera The camera.
+ * @return The scale converting screen positions to gui positions.
+ *
+ * Gui nodes are laid out in display units and scaled to the window by their adjust mode; this matches the default
+ * `gui.ADJUST_FIT`, which scales by the limiting axis. Stretched cameras already work in display units.
  */
-static float remap(const float& value, const float& low1, const float& high1, const float& low2, const float& high2)
+static float GetScreenToGuiScale(const Camera& camera)
 {
-    return low2 + (value - low1) * (high2 - low2) / (high1 - low1);
+    if (camera.scaleMode == SCALE_STRETCH)
+    {
+        return 1.0f;
+    }
+
+    // Screen units are window pixels, or render target pixels before the pixel-perfect upscale
+    float guiScale = fmin(camera.windowWidth / g_State.displayWidth, camera.windowHeight / g_State.displayHeight);
+    return camera.upscale / guiScale;
 }
 
 /**
- * Initializes the camera system with the given camera and world target game objects, and sets the window size.
- * 
- * @param URL|ID cam The game object instance for the camera.
- * @param URL|ID world The game object instance for the world target.
- * @param number width The width of the window.
- * @param number height The height of the window.
- * 
- * @return 0 This function does not return any value.
- * 
- * This function is called to set up the camera system, assigning game objects to the camera and world target,
- * and updating the window dimensions. The camera's world scale is also set based on the world target's scale.
- * It then calls the `Resize` function to update the camera view.
+ * Removes a gui binding and releases the reference to its node.
+ * @param L The Lua state.
+ * @param index The index of the binding.
  */
-static int InitCamera(lua_State* L)
+static void RemoveGuiBinding(lua_State* L, uint32_t index)
 {
-    // Get the game object instances for the camera and world target from the Lua stack
-    dmGameObject::HInstance cam = dmScript::CheckGOInstance(L, 1);
-    dmGameObject::HInstance world = dmScript::CheckGOInstance(L, 2);
-    
-    // Get the window width and height from the Lua stack
-    g_Camera.windowWidth = lua_tonumber(L, 3);
-    g_Camera.windowHeight = lua_tonumber(L, 4);
-
-    // Log the initialized window size
-    dmLogInfo("InitCamera: %f %f", g_Camera.windowWidth, g_Camera.windowHeight);
-    
-    // Set the camera as active and store the provided instances
-    g_State.isActive = true;
-    g_Camera.mainCam = cam;
-    g_Camera.worldTarget = world;
-
-    // Get the scale of the world target and use it as the world scale
-    g_Camera.zoom = dmGameObject::GetScale(world).getX();
-    // g_Camera.worldScale = g_Camera.initScale;
-    // Resize the camera's viewport based on the initial window size
-    Resize(g_Camera.windowWidth, g_Camera.windowHeight);
-    
-    return 0;
+    luaL_unref(L, LUA_REGISTRYINDEX, g_GuiBindings[index].nodeRef);
+    g_GuiBindings.EraseSwap(index);
 }
 
 /**
- * Sets the zoom level of the camera and updates the world target's scale accordingly.
- * @param number zoom The new zoom level for the camera.
- * @return 0 This function does not return any value.
+ * Checks that the node at index 1 still exists. Called protected, as `dmGui::LuaCheckNode` raises an error
+ * for a deleted node.
  */
-static int Zoom(lua_State* L)
+static int CheckBoundNode(lua_State* L)
 {
-    float zoom = lua_tonumber(L, 1);
-    g_Camera.zoom = zoom;
-    
-    dmGameObject::SetScale(g_Camera.worldTarget, Vector3(zoom));
+    dmGui::LuaCheckNode(L, 1);
     return 0;
 }
 
 /**
- * Releases the camera and world target game objects, and marks the camera system as inactive.
- * 
+ * Keeps a gui node over a game object, e.g. a health bar or a name tag. Must be called from a gui script.
+ *
+ * @param node node The node to move. Its position is set relative to the center of the screen, in gui units,
+ * so it is usually the child of a node placed at the center.
+ * @param URL|ID target The game object instance to follow.
+ * @param vector3 [offset] The offset, in gui units, added to the position of the game object. Defaults to zero.
+ * @param number [camera] The camera handle. Defaults to the current camera of each frame.
+ *
  * @return 0 This function does not return any value.
- * 
- * This function deactivates the camera system by clearing the `mainCam` and `worldTarget` references,
- * and updating the camera's state to inactive.
+ *
+ * The nodes are moved by `update_nodes`, called once per frame from the gui script, in place of `gui.set_position`
+ * calls. Binding a node again replaces its binding. The binding ends when the node or the game object is deleted,
+ * or when the collection of the game object is unloaded.
  */
-// Function to release the camera and reset the state
-static int ReleaseCamera(lua_State* L)
+static int BindNode(lua_State* L)
 {
-    // Reset the camera and world target instances
-    g_Camera.mainCam = nullptr;
-    g_Camera.worldTarget = nullptr;
-    
-    // Set the camera state to inactive
-    g_State.isActive = false;
+    GuiBinding binding;
+    binding.scene = dmGui::LuaCheckScene(L);
+    binding.node = dmGui::LuaCheckNode(L, 1);
 
+    dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, 2);
+    binding.collection = dmGameObject::GetCollection(instance);
+    binding.id = dmGameObject::GetIdentifier(instance);
+    WatchCollection(binding.collection);
+    binding.offset = lua_isnoneornil(L, 3) ? Vector3(0.0f) : *dmScript::CheckVector3(L, 3);
+    binding.camera = INVALID_CAMERA_HANDLE;
+    if (!lua_isnoneornil(L, 4))
+    {
+        binding.camera = (uint32_t)luaL_checknumber(L, 4);
+        if (!GetCamera(binding.camera))
+        {
+            return luaL_error(L, "Invalid camera handle");
+        }
+    }
+
+    for (uint32_t i = 0; i < g_GuiBindings.Size(); ++i)
+    {
+        if (g_GuiBindings[i].scene == binding.scene && g_GuiBindings[i].node == binding.node)
+        {
+            binding.nodeRef = g_GuiBindings[i].nodeRef;
+            g_GuiBindings[i] = binding;
+            return 0;
+        }
+    }
+
+    // The node object is kept so update_nodes can check it is still alive
+    lua_pushvalue(L, 1);
+    binding.nodeRef = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    if (g_GuiBindings.Full())
+    {
+        g_GuiBindings.OffsetCapacity(dmMath::Max(64u, g_GuiBindings.Capacity()));
+    }
+    g_GuiBindings.Push(binding);
     return 0;
 }
 
 /**
- * Resizes the camera's window and updates the camera view accordingly.
- * 
- * @param number width The new width of the window.
- * @param number height The new height of the window.
- * 
+ * Stops moving a gui node bound with `bind_node`. Must be called from a gui script.
+ * @param node [node] The node to unbind. Defaults to every node of the gui scene of the script.
  * @return 0 This function does not return any value.
- * 
- * This function updates the camera window dimensions and calls the `Resize` function to adjust the camera's
- * viewport and world target scaling based on the new window size.
  */
-static int ResizeCamera(lua_State* L)
+static int UnbindNode(lua_State* L)
 {
-    // Get the new window size from the Lua stack
-    g_Camera.windowWidth = lua_tonumber(L, 1);
-    g_Camera.windowHeight = lua_tonumber(L, 2);
-    
-    // Resize the camera's viewport based on the new window size
-    Resize(g_Camera.windowWidth, g_Camera.windowHeight);
-    
+    dmGui::HScene scene = dmGui::LuaCheckScene(L);
+    bool isAll = lua_isnoneornil(L, 1);
+    dmGui::HNode node = isAll ? 0 : dmGui::LuaCheckNode(L, 1);
+
+    for (uint32_t i = 0; i < g_GuiBindings.Size();)
+    {
+        const GuiBinding& binding = g_GuiBindings[i];
+        if (binding.scene == scene && (isAll || binding.node == node))
+        {
+            RemoveGuiBinding(L, i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
     return 0;
 }
 
-static int ScreenToWorld(lua_State* L)
+/**
+ * Moves every node of the gui scene of the script over its game object. Call it from `update` of the gui script.
+ * @return 1 The number of moved nodes.
+ *
+ * Only the nodes of the calling scene are touched, so the scene is alive. Bindings whose node or game object has
+ * been deleted are dropped, and those whose camera has been released are skipped.
+ */
+static int UpdateNodes(lua_State* L)
 {
-    // Check if the camera system is active
-    if (!g_State.isActive)
+    dmGui::HScene scene = dmGui::LuaCheckScene(L);
+
+    int count = 0;
+    for (uint32_t i = 0; i < g_GuiBindings.Size();)
     {
-        // If inactive, return nil to the Lua stack
-        lua_pushnil(L);
-        return 1;
-    }
-    
-    float invZoomHalfWidth = g_Camera.invZoom * g_Camera.halfWidth;
-    float invZoomHalfHeight = g_Camera.invZoom * g_Camera.halfHeight;
+        const GuiBinding& binding = g_GuiBindings[i];
+        if (binding.scene != scene)
+        {
+            ++i;
+            continue;
+        }
+
+        dmGameObject::HInstance instance = dmGameObject::GetInstanceFromIdentifier(binding.collection, binding.id);
+        lua_pushcfunction(L, CheckBoundNode);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, binding.nodeRef);
+        bool isNodeAlive = lua_pcall(L, 1, 0, 0) == 0;
+        if (!isNodeAlive)
+        {
+            lua_pop(L, 1);
+        }
+        if (!instance || !isNodeAlive)
+        {
+            RemoveGuiBinding(L, i);
+            continue;
+        }
+        ++i;
 
-    dmVMath::Vector3* out = dmScript::CheckVector3(L, 1);
-    float screenX = out->getX();
-    float screenY = out->getY();
+        const Camera* camera = binding.camera == INVALID_CAMERA_HANDLE ? GetCurrentCamera() : GetCamera(binding.camera);
+        if (!camera)
+        {
+            continue;
+        }
 
-    screenX = remap(screenX, -g_Camera.halfWidth, g_Camera.halfWidth, -invZoomHalfWidth, invZoomHalfWidth);
-    screenY = remap(screenY, -g_Camera.halfHeight, g_Camera.halfHeight, -invZoomHalfHeight, invZoomHalfHeight);
+        const Point3 center = GetEngineScreenCenter(*camera);
+        const Point3 position = dmGameObject::GetWorldPosition(instance);
+        float guiScale = GetScreenToGuiScale(*camera);
 
-    out->setX(screenX);
-    out->setY(screenY);
+        // Only X and Y are written, the node keeps its own Z
+        Vector4 screen = dmGui::GetNodeProperty(binding.scene, binding.node, dmGui::PROPERTY_POSITION);
+        screen.setX((position.getX() - center.getX()) * guiScale + binding.offset.getX());
+        screen.setY((position.getY() - center.getY()) * guiScale + binding.offset.getY());
+        dmGui::SetNodeProperty(binding.scene, binding.node, dmGui::PROPERTY_POSITION, screen);
+        ++count;
+    }
 
-    dmScript::PushVector3(L, *out);
+    lua_pushinteger(L, count);
     return 1;
 }
+
 /**
- * Retrieves the world position of a given game object by factoring in its local position, world position,
- * scale, and rotation.
- * @param URL|ID instance The game object instance for which the world position is requested.
- * @return 1 The function returns the calculated world position as a `Vector3` on the Lua stack.
+ * Advances the follow, zoom tween and shake of a camera.
+ * @param camera The camera to update.
+ * @param dt The time step in seconds.
  */
-static int LocalToWorld(lua_State* L)
+static void UpdateCamera(Camera& camera, float dt)
 {
-    // Check if the camera system is active
-    if (!g_State.isActive)
+    if (camera.isFollowing)
     {
-        // If inactive, return nil to the Lua stack
-        lua_pushnil(L);
-        return 1;
+        UpdateFollow(camera, dt);
     }
 
-    // Get the game object instance for which the world position is requested
-    dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, 1);
+    if (camera.isZooming)
+    {
+        UpdateZoom(camera, dt);
+    }
+
+    // The update that drains the trauma also puts the camera object back in place
+    if (camera.trauma > 0.0f)
+    {
+        UpdateShake(camera, dt);
+    }
+}
+
+/**
+ * Drops every reference to the game objects of a collection that has been deleted.
+ * @param L The Lua state.
+ * @param collection The deleted collection. It is only compared, never dereferenced.
+ *
+ * Cameras whose camera or world target object was in the collection are released; follow targets, parallax layers,
+ * tracked objects, indicators and gui bindings are removed.
+ */
+static void DropCollection(lua_State* L, dmGameObject::HCollection collection)
+{
+    for (uint32_t i = 0; i < MAX_CAMERAS; ++i)
+    {
+        uint32_t handle = g_State.handles[i];
+        Camera* camera = GetCamera(handle);
+        if (!camera)
+        {
+            continue;
+        }
 
-    // Retrieve the world rotation, world position, world scale, and local position of the object
-    const Quat& rotation    = dmGameObject::GetWorldRotation(instance);
-    const Point3& position  = dmGameObject::GetWorldPosition(instance);
-    const Vector3& scale    = dmGameObject::GetWorldScale(instance);
-    const Point3& localPosition  = dmGameObject::GetPosition(instance);
+        if (camera->mainCamCollection == collection || camera->worldTargetCollection == collection)
+        {
+            dmLogWarning("Camera %u released: the collection of its camera or world target game object was unloaded", handle);
+            FreeCamera(handle);
+            continue;
+        }
 
-    Vector3 vecResult ;
+        if (camera->isFollowing && camera->followCollection == collection)
+        {
+            camera->isFollowing = false;
+        }
 
-    vecResult.setX(localPosition.getX() * scale.getX());
-    vecResult.setY(localPosition.getY() * scale.getY());
-    vecResult.setZ(localPosition.getZ() * scale.getZ());
+        // Keep the remaining layers in the order they were added
+        uint32_t layerCount = 0;
+        for (uint32_t j = 0; j < camera->layerCount; ++j)
+        {
+            if (camera->layers[j].collection != collection)
+            {
+                camera->layers[layerCount++] = camera->layers[j];
+            }
+        }
+        camera->layerCount = layerCount;
+    }
 
-    vecResult = dmVMath::Rotate(rotation, vecResult);
+    for (uint32_t i = 0; i < g_Grid.objects.Size();)
+    {
+        if (g_Grid.objects[i].collection == collection)
+        {
+            GridRemove(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
 
-    vecResult.setX(vecResult.getX() + position.getX());
-    vecResult.setY(vecResult.getY() + position.getY());
-    vecResult.setZ(vecResult.getZ() + position.getZ());
+    for (uint32_t i = 0; i < g_Indicators.Size(); ++i)
+    {
+        if (g_Indicators[i].collection == collection)
+        {
+            g_Indicators[i].isActive = false;
+        }
+    }
+    while (!g_Indicators.Empty() && !g_Indicators.Back().isActive)
+    {
+        g_Indicators.Pop();
+    }
 
-    dmScript::PushVector3(L, vecResult);
-    return 1;
+    for (uint32_t i = 0; i < g_GuiBindings.Size();)
+    {
+        if (g_GuiBindings[i].collection == collection)
+        {
+            RemoveGuiBinding(L, i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
 }
 
 /**
- * Retrieves the world position of a given game object by factoring in its local position, world position,
- * scale, and rotation.
- * 
- * @param URL|ID instance The game object instance for which the world position is requested.
- * 
- * @return 1 The function returns the calculated world position as a `Vector3` on the Lua stack.
- * 
- * This function computes the final world position of the object by adding the local position to the world position.
- * It then applies the inverse of the object's rotation and scales the result by the object's world scale.
- * This provides the accurate world position, which is then returned to the Lua script.
+ * Drops the references to the collections unloaded since the previous call.
+ * @param L The Lua state.
+ *
+ * The SDK has no way to ask whether a collection handle is still alive, but the message socket of a collection is
+ * deleted with it and can be looked up by its name at any time. Collection proxies delete their collection after the
+ * script updates and create one during them, so with a call before rendering and one at the start of the frame, an
+ * unloaded collection is noticed before a reload can reuse its socket name.
  */
-static int WorldToLocal(lua_State* L)
+static void PurgeCollections(lua_State* L)
 {
-    // Check if the camera system is active
-    if (!g_State.isActive)
+    for (uint32_t i = 0; i < g_Collections.Size();)
     {
-        // If inactive, return nil to the Lua stack
-        lua_pushnil(L);
-        return 1;
+        if (dmMessage::IsSocketValid(g_Collections[i].socket))
+        {
+            ++i;
+            continue;
+        }
+
+        DropCollection(L, g_Collections[i].collection);
+        g_Collections.EraseSwap(i);
     }
+}
 
-    // Get the game object instance for which the world position is requested
-    dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, 1);
+/**
+ * Looks up the camera and world target game objects of every camera from their identifiers.
+ *
+ * Called at the start of the frame and before rendering, after the engine deleted the game objects of the frame,
+ * so the conversions keep the handles of the objects without looking them up. A camera whose objects were deleted
+ * (e.g. by `go.delete`) is released instead of touching them.
+ */
+static void ResolveCameras()
+{
+    for (uint32_t i = 0; i < MAX_CAMERAS; ++i)
+    {
+        uint32_t handle = g_State.handles[i];
+        Camera* camera = GetCamera(handle);
+        if (!camera)
+        {
+            continue;
+        }
 
-    // Retrieve the world rotation, world position, world scale, and local position of the object
-    const Quat& rotation    = dmGameObject::GetWorldRotation(instance);
-    const Point3& position  = dmGameObject::GetWorldPosition(instance);
-    const Vector3& scale    = dmGameObject::GetWorldScale(instance);
-    const Point3& localPosition  = dmGameObject::GetPosition(instance);
+        camera->mainCam = dmGameObject::GetInstanceFromIdentifier(camera->mainCamCollection, camera->mainCamId);
+        camera->worldTarget = dmGameObject::GetInstanceFromIdentifier(camera->worldTargetCollection, camera->worldTargetId);
+        if (!camera->mainCam || !camera->worldTarget)
+        {
+            dmLogWarning("Camera %u released: its camera or world target game object was deleted", handle);
+            FreeCamera(handle);
+        }
+    }
+}
 
-    // Calculate the inverse of the rotation quaternion
-    const Quat& invQuat = Conjugate(rotation);
-    
-    // Initialize a vector to hold the result
-    Vector3 vecResult ;
+/**
+ * Adds a parallax layer to the camera, or updates it if the game object already is a layer.
+ * @param URL|ID layer The game object holding the layer, e.g. a background. It is moved and scaled by the camera.
+ * @param number factor The part of the camera movement applied to the layer: 0 keeps it fixed on screen, 1 moves it
+ * with the world, and values in between make it look further away.
+ * @param number [zoom_factor] The part of the camera zoom applied to the layer: 0 ignores the zoom, 1 zooms it
+ * with the world. Defaults to 1.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 0 This function does not return any value.
+ *
+ * The layers are updated in the same pass as the world target. A layer is removed when the
+ * collection of its game object is unloaded.
+ */
+static int AddLayer(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 4);
+    if (!camera)
+    {
+        return 0;
+    }
 
-    // Combine the local position and world position to get the final position in the world space
-    vecResult.setX(localPosition.getX() + position.getX());
-    vecResult.setY(localPosition.getY() + position.getY());
-    vecResult.setZ(localPosition.getZ() + position.getZ());
+    dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, 1);
+    dmGameObject::HCollection collection = dmGameObject::GetCollection(instance);
+    dmhash_t id = dmGameObject::GetIdentifier(instance);
+    WatchCollection(collection);
+    float factor = luaL_checknumber(L, 2);
+    float zoomFactor = luaL_optnumber(L, 3, 1.0f);
 
-    // Apply the inverse rotation to the position to get the position in the local space
-    vecResult = dmVMath::Rotate(invQuat, vecResult);
+    uint32_t i = 0;
+    while (i < camera->layerCount && (camera->layers[i].collection != collection || camera->layers[i].id != id))
+    {
+        ++i;
+    }
+    if (i == MAX_LAYERS)
+    {
+        return luaL_error(L, "Unable to add more than %d layers", MAX_LAYERS);
+    }
+    if (i == camera->layerCount)
+    {
+        ++camera->layerCount;
+    }
 
-    // Adjust the position based on the object's scale
-    vecResult.setX(vecResult.getX() / scale.getX());
-    vecResult.setY(vecResult.getY() / scale.getY());
-    vecResult.setZ(vecResult.getZ() / scale.getZ());
-    
-    // Push the calculated world position as a vector onto the Lua stack
-    dmScript::PushVector3(L, vecResult);
-    
-    return 1;
+    ParallaxLayer& layer = camera->layers[i];
+    layer.collection = collection;
+    layer.id = id;
+    layer.factor = factor;
+    layer.zoomFactor = zoomFactor;
+    camera->pending |= PENDING_VIEW;
+    FlushCamera(*camera);
+    return 0;
+}
+
+/**
+ * Removes a parallax layer from the camera. The game object is left where it is.
+ * @param URL|ID layer The game object holding the layer.
+ * @param number [camera] The camera handle. Defaults to the current camera.
+ * @return 0 This function does not return any value.
+ */
+static int RemoveLayer(lua_State* L)
+{
+    Camera* camera = CheckCamera(L, 2);
+    if (!camera)
+    {
+        return 0;
+    }
+
+    dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, 1);
+    dmGameObject::HCollection collection = dmGameObject::GetCollection(instance);
+    dmhash_t id = dmGameObject::GetIdentifier(instance);
+    for (uint32_t i = 0; i < camera->layerCount; ++i)
+    {
+        if (camera->layers[i].collection == collection && camera->layers[i].id == id)
+        {
+            // Keep the layers in the order they were added
+            --camera->layerCount;
+            memmove(&camera->layers[i], &camera->layers[i + 1], (camera->layerCount - i) * sizeof(ParallaxLayer));
+            break;
+        }
+    }
+    return 0;
 }
 
 // Functions exposed to Lua
 static const luaL_reg Module_methods[] =
 {
+    {"add_indicator", AddIndicator},
+    {"add_layer", AddLayer},
+    {"add_trauma", AddTrauma},
+    {"bind_node", BindNode},
+    {"clear_bounds", ClearBounds},
+    {"follow", Follow},
+    {"get_allocation_count", GetAllocationCount},
+    {"get_camera", GetCameraHandle},
+    {"get_frustum", GetFrustum},
+    {"get_pixel_scale", GetPixelScale},
+    {"get_position", GetPosition},
+    {"get_projection", GetProjection},
+    {"get_transform_cache_stats", GetTransformCacheStats},
+    {"get_trauma", GetTrauma},
+    {"get_viewport", GetViewport},
+    {"get_visible", GetVisible},
     {"init_camera", InitCamera},
+    {"is_visible", IsVisible},
     {"local_to_world", LocalToWorld},
+    {"local_to_world_batch", LocalToWorldBatch},
+    {"local_to_world_xyz", LocalToWorldXYZ},
+    {"query_radius", QueryRadius},
+    {"query_view", QueryView},
     {"resize", ResizeCamera},
     {"release_camera", ReleaseCamera},
+    {"remove_indicator", RemoveIndicator},
+    {"remove_layer", RemoveLayer},
     {"screen_to_world", ScreenToWorld},
+    {"screen_to_world_batch", ScreenToWorldBatch},
+    {"screen_to_world_xy", ScreenToWorldXY},
+    {"set_bounds", SetBounds},
+    {"set_camera", SetCamera},
+    {"set_cull_margin", SetCullMargin},
+    {"set_grid_cell_size", SetGridCellSize},
+    {"set_orthographic", SetOrthographic},
+    {"set_perspective", SetPerspective},
+    {"set_pixel_perfect", SetPixelPerfect},
+    {"set_position", SetPosition},
+    {"set_scale_mode", SetScaleMode},
+    {"set_shake", SetShake},
+    {"set_transform_cache", SetTransformCache},
+    {"set_transform_mode", SetTransformMode},
+    {"track", Track},
+    {"unbind_node", UnbindNode},
+    {"unfollow", Unfollow},
+    {"untrack", Untrack},
+    {"update_indicators", UpdateIndicators},
+    {"update_nodes", UpdateNodes},
     {"world_to_local", WorldToLocal},
+    {"world_to_local_batch", WorldToLocalBatch},
+    {"world_to_local_xyz", WorldToLocalXYZ},
+    {"world_to_screen", WorldToScreen},
+    {"world_to_screen_batch", WorldToScreenBatch},
+    {"world_to_screen_xy", WorldToScreenXY},
     {"zoom", Zoom},
+    {"zoom_to_point", ZoomToPoint},
 	{0, 0}
 };
 static void LuaInit(lua_State* L)
@@ -338,15 +3760,53 @@ static void LuaInit(lua_State* L)
 	// Register lua names
 	luaL_register(L, MODULE_NAME, Module_methods);
 
+#define SETCONSTANT(name) \
+	lua_pushnumber(L, (lua_Number) name); \
+	lua_setfield(L, -2, #name); \
+
+	SETCONSTANT(EASING_LINEAR);
+	SETCONSTANT(EASING_IN_OUT_SINE);
+	SETCONSTANT(EASING_OUT_CUBIC);
+	SETCONSTANT(EASING_IN_OUT_CUBIC);
+
+	SETCONSTANT(TRANSFORM_GENERAL);
+	SETCONSTANT(TRANSFORM_2D);
+
+	SETCONSTANT(SCALE_EXPAND);
+	SETCONSTANT(SCALE_FIT);
+	SETCONSTANT(SCALE_FILL);
+	SETCONSTANT(SCALE_STRETCH);
+
+#undef SETCONSTANT
+
 	lua_pop(L, 1);
 	assert(top == lua_gettop(L));
 }
 
+static ExtensionResult OnPreRenderMyExtension(dmExtension::Params* params)
+{
+	// Game objects and collections are deleted after the script updates, before rendering
+	PurgeCollections(params->m_L);
+	ResolveCameras();
+
+	return EXTENSION_RESULT_OK;
+}
+
 static dmExtension::Result AppInitializeMyExtension(dmExtension::AppParams* params)
 {
-	g_Camera.displayWidth = dmConfigFile::GetInt(params->m_ConfigFile, "display.width", DISPLAY_WIDTH);
-	g_Camera.displayHeight = dmConfigFile::GetInt(params->m_ConfigFile, "display.height", DISPLAY_HEIGHT);
-	dmLogInfo("AppInitializeMyExtension: %d %d", g_Camera.displayWidth, g_Camera.displayHeight);
+	g_State.displayWidth = dmConfigFile::GetInt(params->m_ConfigFile, "display.width", DISPLAY_WIDTH);
+	g_State.displayHeight = dmConfigFile::GetInt(params->m_ConfigFile, "display.height", DISPLAY_HEIGHT);
+	dmLogInfo("AppInitializeMyExtension: %d %d", g_State.displayWidth, g_State.displayHeight);
+
+#if defined(BOCOCAM_SSE2) || defined(BOCOCAM_NEON)
+	// The SIMD batch kernels can be disabled from game.project to compare against the scalar path
+	if (dmConfigFile::GetInt(params->m_ConfigFile, "bococam.simd", 1))
+	{
+		g_AffineKernel = AffineKernelSIMD;
+	}
+#endif
+
+	dmExtension::RegisterCallback(dmExtension::CALLBACK_PRE_RENDER, OnPreRenderMyExtension);
 
     return dmExtension::RESULT_OK;
 }
@@ -370,6 +3830,42 @@ static dmExtension::Result FinalizeMyExtension(dmExtension::Params* params)
 
 static dmExtension::Result OnUpdateMyExtension(dmExtension::Params* params)
 {
+	// Frame delta, clamped so a hitch or a suspended app does not make the camera jump
+	uint64_t now = dmTime::GetTime();
+	float dt = g_State.lastUpdateTime == 0 ? 0.0f : dmMath::Min((now - g_State.lastUpdateTime) * 0.000001f, MAX_TIME_STEP);
+	g_State.lastUpdateTime = now;
+
+	// A new frame starts
+	g_State.lastAllocations = g_State.allocations;
+	g_State.allocations = 0;
+
+	PurgeCollections(params->m_L);
+	ResolveCameras();
+
+	// Advance the native steps and write their result before the game objects update
+	for (uint32_t i = 0; i < MAX_CAMERAS; ++i)
+	{
+		Camera* camera = GetCamera(g_State.handles[i]);
+		if (!camera)
+		{
+			continue;
+		}
+
+		if (dt > 0.0f)
+		{
+			UpdateCamera(*camera, dt);
+		}
+		FlushCamera(*camera);
+	}
+
+	// Game objects may have moved since the previous frame
+	g_TransformCache.entries.Clear();
+
+	// Refresh the spatial grid once per frame
+	if (!g_Grid.objects.Empty())
+	{
+		UpdateGrid();
+	}
 	return dmExtension::RESULT_OK;
 }
 
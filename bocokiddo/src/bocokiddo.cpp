@@ -4,44 +4,210 @@
 #define MODULE_NAME "bocokiddo"
 
 #include <dmsdk/sdk.h>
+#include <dmsdk/dlib/math.h>
+#include <dmsdk/dlib/hashtable.h>
 
-static int GetWorldPosition(lua_State* L)
+// Transform math of the position queries
+enum TransformMode
+{
+	TRANSFORM_GENERAL = 0,	// Any rotation and three-axis scale
+	TRANSFORM_2D = 1,	// Rotation around Z only, with a 2x2 rotation
+};
+
+static TransformMode g_TransformMode = TRANSFORM_GENERAL;
+
+// Transforms of the game objects queried this frame, keyed by instance and cleared in the extension update
+struct CachedTransform
+{
+	dmTransform::Transform m_World;
+	dmVMath::Point3 m_LocalPosition;
+};
+
+static dmHashTable64<CachedTransform> g_TransformCache;
+static bool g_TransformCacheEnabled = false;
+static uint32_t g_CacheHits = 0;
+static uint32_t g_CacheMisses = 0;
+
+static CachedTransform GetInstanceTransform(dmGameObject::HInstance instance)
+{
+	dmhash_t key = (dmhash_t)(uintptr_t)instance;
+	if (g_TransformCacheEnabled)
+	{
+		const CachedTransform* cached = g_TransformCache.Get(key);
+		if (cached)
+		{
+			++g_CacheHits;
+			return *cached;
+		}
+		++g_CacheMisses;
+	}
+
+	CachedTransform transform;
+	transform.m_World = dmGameObject::GetWorldTransform(instance);
+	transform.m_LocalPosition = dmGameObject::GetPosition(instance);
+
+	if (g_TransformCacheEnabled)
+	{
+		if (g_TransformCache.Full())
+		{
+			g_TransformCache.SetCapacity(dmMath::Max(64u, g_TransformCache.Capacity() * 2));
+		}
+		g_TransformCache.Put(key, transform);
+	}
+	return transform;
+}
+
+template <TransformMode MODE>
+static dmVMath::Vector3 CalcWorldPosition(const CachedTransform& transform);
+
+template <>
+dmVMath::Vector3 CalcWorldPosition<TRANSFORM_GENERAL>(const CachedTransform& transform)
 {
 	using namespace dmVMath;
 
-	dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, 1);
+	// Single world transform fetch; the scale is divided, so a zero scale gives inf/NaN rather than an assert
+	const dmTransform::Transform& world = transform.m_World;
 
-	const Quat& rotation    = dmGameObject::GetWorldRotation(instance);
+	const Point3& localPosition  = transform.m_LocalPosition;
 
-	const Point3& position  = dmGameObject::GetWorldPosition(instance);
+	Vector3 vecResult = Vector3(localPosition) + world.GetTranslation();
 
-	const Vector3& scale    = dmGameObject::GetWorldScale(instance);
+	vecResult = dmVMath::Rotate(conj(world.GetRotation()), vecResult);
 
-	const Point3& localPosition  = dmGameObject::GetPosition(instance);
+	return divPerElem(vecResult, world.GetScale());
+}
 
-	const Quat& invQuat = Conjugate(rotation);
-	
-	Vector3 vecResult ;
+template <>
+dmVMath::Vector3 CalcWorldPosition<TRANSFORM_2D>(const CachedTransform& transform)
+{
+	using namespace dmVMath;
 
-	vecResult.setX(localPosition.getX() + position.getX());
-	vecResult.setY(localPosition.getY() + position.getY());
-	vecResult.setZ(localPosition.getZ() + position.getZ());
-	
-	vecResult = dmVMath::Rotate(invQuat, vecResult);
+	const dmTransform::Transform& world = transform.m_World;
 
-	vecResult.setX(vecResult.getX() / scale.getX());
-	vecResult.setY(vecResult.getY() / scale.getY());
-	vecResult.setZ(vecResult.getZ() / scale.getZ());
-	
-	dmScript::PushVector3(L, vecResult);
+	// Rotated around another axis than Z: not 2D
+	const Quat rotation = world.GetRotation();
+	if (rotation.getX() != 0.0f || rotation.getY() != 0.0f)
+	{
+		return CalcWorldPosition<TRANSFORM_GENERAL>(transform);
+	}
+
+	// Rotate back by the Z angle (cosine w^2 - z^2, sine 2wz), then undo the scale
+	float w = rotation.getW(), z = rotation.getZ();
+	float cosAngle = w * w - z * z;
+	float sinAngle = 2.0f * w * z;
+
+	const Point3& localPosition  = transform.m_LocalPosition;
+	const Vector3 scale = world.GetScale();
+	const Vector3 translation = world.GetTranslation();
+	float x = localPosition.getX() + translation.getX();
+	float y = localPosition.getY() + translation.getY();
+	return Vector3((cosAngle * x + sinAngle * y) / scale.getX(),
+		(cosAngle * y - sinAngle * x) / scale.getY(),
+		(localPosition.getZ() + translation.getZ()) / scale.getZ());
+}
+
+static bool Is2D(lua_State* L, int index)
+{
+	TransformMode mode = lua_isnoneornil(L, index) ? g_TransformMode : (TransformMode)luaL_checkinteger(L, index);
+	return mode == TRANSFORM_2D;
+}
+
+// bocokiddo.get_world_position(instance, [mode])
+static int GetWorldPosition(lua_State* L)
+{
+	dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, 1);
+
+	const CachedTransform transform = GetInstanceTransform(instance);
+	dmScript::PushVector3(L, Is2D(L, 2) ? CalcWorldPosition<TRANSFORM_2D>(transform) : CalcWorldPosition<TRANSFORM_GENERAL>(transform));
 	
 	return 1;
 }
 
+// bocokiddo.get_world_position_batch(instances, buffer, stream, [mode])
+// Writes the position of every instance in the array into a float32 stream (2 or 3 components)
+// and returns the number of written elements.
+static int GetWorldPositionBatch(lua_State* L)
+{
+	luaL_checktype(L, 1, LUA_TTABLE);
+	dmBuffer::HBuffer buffer = dmScript::CheckBufferUnpack(L, 2);
+	dmhash_t stream_name = dmScript::CheckHashOrString(L, 3);
+
+	dmBuffer::ValueType type;
+	uint32_t components = 0;
+	dmBuffer::Result result = dmBuffer::GetStreamType(buffer, stream_name, &type, &components);
+	if (result != dmBuffer::RESULT_OK || type != dmBuffer::VALUE_TYPE_FLOAT32 || components < 2)
+	{
+		return luaL_error(L, "Stream '%s' must be float32 with at least 2 components", dmHashReverseSafe64(stream_name));
+	}
+
+	float* out = 0;
+	uint32_t out_count = 0, stride = 0;
+	dmBuffer::GetStream(buffer, stream_name, (void**)&out, &out_count, &components, &stride);
+
+	uint32_t count = dmMath::Min((uint32_t)lua_objlen(L, 1), out_count);
+	dmVMath::Vector3 (*calc)(const CachedTransform&) = Is2D(L, 4) ? CalcWorldPosition<TRANSFORM_2D> : CalcWorldPosition<TRANSFORM_GENERAL>;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		lua_rawgeti(L, 1, i + 1);
+		dmGameObject::HInstance instance = dmScript::CheckGOInstance(L, -1);
+		lua_pop(L, 1);
+
+		const dmVMath::Vector3 position = calc(GetInstanceTransform(instance));
+		out[0] = position.getX();
+		out[1] = position.getY();
+		if (components > 2)
+		{
+			out[2] = position.getZ();
+		}
+		out += stride;
+	}
+
+	dmBuffer::UpdateContentVersion(buffer);
+
+	lua_pushinteger(L, count);
+	return 1;
+}
+
+// bocokiddo.set_transform_mode(mode)
+// Sets the default mode of the position queries, bocokiddo.TRANSFORM_GENERAL or bocokiddo.TRANSFORM_2D.
+static int SetTransformMode(lua_State* L)
+{
+	g_TransformMode = luaL_checkinteger(L, 1) == TRANSFORM_2D ? TRANSFORM_2D : TRANSFORM_GENERAL;
+	return 0;
+}
+
+// bocokiddo.set_transform_cache(enabled)
+// The cache is opt-in: once enabled, a game object moved after its first query of the frame keeps its first position until the next frame.
+static int SetTransformCache(lua_State* L)
+{
+	g_TransformCacheEnabled = lua_toboolean(L, 1);
+	g_TransformCache.Clear();
+	return 0;
+}
+
+// bocokiddo.get_transform_cache_stats([reset])
+// Returns the number of cache hits and misses, optionally resetting them.
+static int GetTransformCacheStats(lua_State* L)
+{
+	lua_pushinteger(L, g_CacheHits);
+	lua_pushinteger(L, g_CacheMisses);
+	if (lua_toboolean(L, 1))
+	{
+		g_CacheHits = 0;
+		g_CacheMisses = 0;
+	}
+	return 2;
+}
+
 // Functions exposed to Lua
 static const luaL_reg Module_methods[] =
 {
+	{"get_transform_cache_stats", GetTransformCacheStats},
 	{"get_world_position", GetWorldPosition},
+	{"get_world_position_batch", GetWorldPositionBatch},
+	{"set_transform_cache", SetTransformCache},
+	{"set_transform_mode", SetTransformMode},
 	{0, 0}
 };
 static void LuaInit(lua_State* L)
@@ -51,6 +217,11 @@ static void LuaInit(lua_State* L)
 	// Register lua names
 	luaL_register(L, MODULE_NAME, Module_methods);
 
+	lua_pushnumber(L, TRANSFORM_GENERAL);
+	lua_setfield(L, -2, "TRANSFORM_GENERAL");
+	lua_pushnumber(L, TRANSFORM_2D);
+	lua_setfield(L, -2, "TRANSFORM_2D");
+
 	lua_pop(L, 1);
 	assert(top == lua_gettop(L));
 }
@@ -79,6 +250,8 @@ static dmExtension::Result FinalizeMyExtension(dmExtension::Params* params)
 
 static dmExtension::Result OnUpdateMyExtension(dmExtension::Params* params)
 {
+	// Game objects may have moved since the previous frame
+	g_TransformCache.Clear();
 	return dmExtension::RESULT_OK;
 }
 